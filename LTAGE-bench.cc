@@ -0,0 +1,636 @@
+//Microbenchmarks for the LTAGE-final hot paths
+//
+//Build next to the simulator sources:
+//	g++ -O2 -pthread -I<sim dir> LTAGE-bench.cc -o ltage-bench
+//and with every tagged table grown 2^8 times (2^17 to 2^19 rows, about 20MB, well past L2):
+//	g++ -O2 -pthread -DTAGE_TABLE_GROW=8 -I<sim dir> LTAGE-bench.cc -o ltage-bench-large
+//Run:
+//	./ltage-bench [reps] [ops] > bench.csv
+//	./ltage-bench check [branches]
+//
+//Each benchmark runs on its own pre-warmed predictor with a fixed seed and fixed inputs,
+//and prints one csv row: name,reps,ops,ns_per_op,ns_stddev,cycles_per_op,cycles_stddev
+//Cycles come from the time stamp counter, so they are 0 on hosts without one.
+//
+//The replay benchmarks run a precomputed index stream with each prefetch distance in
+//BENCH_PREFETCH. The default geometry's tagged tables fit in L2, so the rows are within
+//noise of each other there. ltage-bench-large is the build the reduced stalls show in.
+//
+//The replay_delay benchmarks run the same stream with table writes held back by each delay
+//in BENCH_DELAY, to compare against replay_prefetch_0's immediate updates. replay_delay_0
+//runs every write through the queue but lands it before the next lookup, so it predicts
+//exactly like replay_prefetch_0 and the gap between them is the queue's own cost.
+//
+//loop_table looks up and trains the loop table alone over the stream's branches. Build with
+//each LOOP_WAYS to compare the direct-mapped table against the packed sets, STORAGE_REPORT
+//gives the host bytes of each. Sets only predict better when loop branches conflict in the
+//direct-mapped slots, otherwise they just cost the search.
+//
+//The multi benchmarks run BENCH_GROUP independent predictors over their own streams, one
+//after another and then interleaved with runInterleaved(). Their ops are branches summed
+//over every instance, so 1e9/ns_per_op is the aggregate branches per second on one core.
+//Both rows start from fresh predictors, and the bench exits with 1 if any instance misses
+//differently interleaved. The gap between them shows in ltage-bench-large.
+//check runs a synthetic trace through GetPrediction/UpdatePredictor and again through
+//predict()/update() with each of CHECK_INFLIGHT tokens in flight, then BENCH_GROUP traces
+//sequentially and interleaved. It exits with 1 if one token in flight predicts differently
+//from the legacy calls, if an instance misses differently interleaved, or if a miss count of
+//the default trace isn't the one recorded in CHECK_MISS. Last it prints the loop branch misses
+//of a trace whose loops conflict in the direct-mapped loop table, which sets of LOOP_WAYS >=
+//CHECK_LOOP_SHARE resolve.
+#include "LTAGE-final.cc"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES() __rdtsc()
+#else
+#define READ_CYCLES() 0
+#endif
+
+using namespace ltageFinal;
+
+#define BENCH_PCS     64       //distinct branches per benchmark (power of 2)
+#define BENCH_PC_BASE 0x400000 //first branch address, branches are 16 bytes apart
+#define BENCH_WARMUP  (1<<20)  //branches used to warm each predictor
+#define BENCH_REPS    20       //default repetitions per benchmark
+#define BENCH_OPS     (1<<16)  //default operations per repetition
+#define BENCH_TABLE   (NUM_TAGE_TABLES/2) //provider table for the TAGE hit and update paths
+#define BENCH_STREAM_PCS (1<<16) //distinct branches in the replayed stream
+#define BENCH_GROUP   8        //independent predictors in the multi benchmarks
+#define CHECK_BRANCHES (1<<21) //default branches for check
+#define CHECK_LOOP_SHARE 2       //loop branches per direct-mapped loop slot in check's loop trace
+
+//branches check keeps in flight between predict() and update(), 1 first
+const UINT32 CHECK_INFLIGHT[] = {1, 4, 16};
+//misses of the default check trace with each of CHECK_INFLIGHT in flight. A change that is
+//meant to move them updates them here. With one in flight (and the legacy calls) it was
+//936060 on the original tree and on the tree tokens were added to, 936322 once loopTrain
+//compared tags modulo LOOP_TAG_SIZE, 936087 with the tables resized into the 32KB class,
+//936074 with each predictor drawing allocations from its own lcg, and 936048 once a new loop
+//entry learned its trip count without waiting for another PC to age it
+const UINT64 CHECK_MISS[] = {936048, 936131, 934934};
+
+const UINT32 BENCH_PREFETCH[] = {0, 2, 4, 8, 16}; //prefetch distances for the replay benchmarks
+const UINT32 BENCH_DELAY[] = {0, 1, 16};           //update delays for the replay benchmarks
+
+volatile UINT32 sink; //keeps the timed results alive
+
+class PREDICTOR_BENCH{
+public:
+	PREDICTOR_BENCH(UINT32 reps, UINT32 ops);
+	~PREDICTOR_BENCH();
+	bool    run();
+	bool    checkTokens(UINT32 n);
+	bool    checkGroup(UINT32 n);
+	void    checkLoops(UINT32 n);
+
+private:
+	typedef void (PREDICTOR_BENCH::*benchFn)(UINT32 ops);
+
+	PREDICTOR *p;
+	UINT32 reps;
+	UINT32 ops;
+	UINT32 pcs[BENCH_PCS];
+	UINT32 numPcs;                        //number of pcs that take the path being timed
+	bool   dirs[BENCH_PCS];
+	UINT32 *streamPCs;                    //replayed trace, ops branches long
+	bool   *streamDirs;
+	INDEX_STREAM *stream;
+	instance_t group[BENCH_GROUP];        //instances for the multi benchmarks
+	UINT32 *groupPCs[BENCH_GROUP];
+	bool   *groupDirs[BENCH_GROUP];
+	INDEX_STREAM *groupStreams[BENCH_GROUP];
+
+	void    reset();
+	void    plantLoop();
+	void    plantTage(UINT32 table);
+	bool    checkPath(UINT32 PC, UINT32 table, bool loopHit);
+	void    keepPath(UINT32 table, bool loopHit);
+	void    makeStream();
+	void    makeTrace(UINT32 seed, UINT32 n, UINT32 *PCs, bool *dirs);
+	void    makeGroup();
+	void    measure(const char *name, benchFn fn);
+
+	void    benchIndex(UINT32 ops);
+	void    benchTag(UINT32 ops);
+	void    benchFold(UINT32 ops);
+	void    benchPredict(UINT32 ops);
+	void    benchUpdateAlloc(UINT32 ops);
+	void    benchUpdateNoAlloc(UINT32 ops);
+	void    benchReplay(UINT32 ops);
+	void    benchLoop(UINT32 ops);
+	void    benchSequential(UINT32 ops);
+	void    benchInterleaved(UINT32 ops);
+};
+
+PREDICTOR_BENCH::PREDICTOR_BENCH(UINT32 reps, UINT32 ops){
+	this->reps = reps;
+	this->ops = ops;
+	p = NULL;
+	for(UINT32 i = 0; i < BENCH_PCS; i++) {
+		pcs[i] = BENCH_PC_BASE + 16*i; //distinct bimodal and loop entries
+		dirs[i] = (i % 3) != 0;
+	}
+	numPcs = BENCH_PCS;
+	streamPCs = NULL;
+	streamDirs = NULL;
+	stream = NULL;
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		group[g].p = NULL;
+		groupPCs[g] = NULL;
+		groupDirs[g] = NULL;
+		groupStreams[g] = NULL;
+	}
+}
+
+PREDICTOR_BENCH::~PREDICTOR_BENCH(){
+	delete p;
+	delete stream;
+	delete[] streamPCs;
+	delete[] streamDirs;
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		delete group[g].p;
+		delete groupStreams[g];
+		delete[] groupPCs[g];
+		delete[] groupDirs[g];
+	}
+}
+
+//new predictor warmed with a fixed synthetic stream, then a fixed seed for allocation
+void PREDICTOR_BENCH::reset(){
+	delete p;
+	p = new PREDICTOR();
+	UINT32 s = 12345;
+	for(UINT32 i = 0; i < BENCH_WARMUP; i++) {
+		s = s * 1664525 + 1013904223;
+		UINT32 PC = BENCH_PC_BASE + ((s >> 8) % 4096) * 4;
+		bool dir = (PC % 3 == 0) ? ((i % 7) != 0) : ((PC >> 3) & 1);
+		bool predDir = p->GetPrediction(PC);
+		p->UpdatePredictor(PC, dir, predDir, PC + 64);
+	}
+	srand(1);
+	numPcs = BENCH_PCS;
+}
+
+//make every pc a confident loop that is still iterating
+void PREDICTOR_BENCH::plantLoop(){
+	for(UINT32 i = 0; i < BENCH_PCS; i++) {
+		UINT32 index = p->loopEntry(pcs[i]);
+		loopVal_t entry;
+		p->loopRead(index, &entry);
+		entry.tag = pcs[i] % (1<<LOOP_TAG_SIZE);
+		entry.conf = LOOP_CONF_MAX;
+		entry.loopCount = (1<<LOOP_IT_MAX);
+		entry.currentIter = 0;
+		p->loopWrite(index, &entry);
+	}
+}
+
+//make every pc miss the loop table and tables above table, and hit table
+//(table == NUM_TAGE_TABLES means miss everything and use bimodal)
+void PREDICTOR_BENCH::plantTage(UINT32 table){
+	for(UINT32 i = 0; i < BENCH_PCS; i++) {
+		UINT32 PC = pcs[i];
+		UINT32 loopIndex = p->loopEntry(PC);
+		loopVal_t entry;
+		p->loopRead(loopIndex, &entry);
+		entry.conf = 0;
+		p->loopWrite(loopIndex, &entry);
+		for(UINT32 t = 0; t < NUM_TAGE_TABLES && t <= table; t++) {
+			UINT32 index = p->getIndex(PC, t, p->tageTableSize[t], 0);
+			UINT32 tag = p->getTag(PC, t, p->tageTagSize[t]);
+			if(t == table)
+				p->tagTables[t][index].tag = tag;
+			else if(p->tagTables[t][index].tag == tag)
+				p->tagTables[t][index].tag = tag ^ 1;
+		}
+	}
+}
+
+bool PREDICTOR_BENCH::checkPath(UINT32 PC, UINT32 table, bool loopHit){
+	p->GetPrediction(PC);
+	if(loopHit)
+		return p->loopUsed;
+	return !p->loopUsed && p->pred.table == (int)table;
+}
+
+//later plants can overwrite earlier ones, so only keep pcs that really take the path
+void PREDICTOR_BENCH::keepPath(UINT32 table, bool loopHit){
+	UINT32 n = 0;
+	for(UINT32 i = 0; i < BENCH_PCS; i++) {
+		if(checkPath(pcs[i], table, loopHit)) {
+			UINT32 tmp = pcs[n];
+			pcs[n++] = pcs[i];
+			pcs[i] = tmp;
+		}
+	}
+	//round down to a power of 2 so the timed loops can mask
+	numPcs = 1;
+	while(numPcs * 2 <= n)
+		numPcs *= 2;
+	if(n == 0) {
+		fprintf(stderr, "no branch takes the requested path\n");
+		exit(1);
+	}
+}
+
+//n branches spread over BENCH_STREAM_PCS pcs so rows are scattered across every table
+void PREDICTOR_BENCH::makeTrace(UINT32 seed, UINT32 n, UINT32 *PCs, bool *dirs){
+	UINT32 s = seed;
+	for(UINT32 k = 0; k < n; k++) {
+		s = s * 1664525 + 1013904223;
+		PCs[k] = BENCH_PC_BASE + ((s >> 8) % BENCH_STREAM_PCS) * 4;
+		dirs[k] = (PCs[k] % 3 == 0) ? ((k % 7) != 0) : ((s >> 4) & 1);
+	}
+}
+
+void PREDICTOR_BENCH::makeStream(){
+	streamPCs = new UINT32[ops];
+	streamDirs = new bool[ops];
+	makeTrace(54321, ops, streamPCs, streamDirs);
+	stream = new INDEX_STREAM();
+	stream->build(streamPCs, streamDirs, ops, 1);
+}
+
+//BENCH_GROUP fresh predictors, each with its own trace and stream, ops branches in total.
+//The traces and streams are made once, later calls only replace the predictors
+void PREDICTOR_BENCH::makeGroup(){
+	UINT32 n = ops / BENCH_GROUP;
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		if(!groupPCs[g]) {
+			groupPCs[g] = new UINT32[n];
+			groupDirs[g] = new bool[n];
+			makeTrace(1000 + g, n, groupPCs[g], groupDirs[g]);
+			groupStreams[g] = new INDEX_STREAM();
+			groupStreams[g]->build(groupPCs[g], groupDirs[g], n, 1);
+		}
+		delete group[g].p;
+		group[g].p = new PREDICTOR();
+		group[g].PCs = groupPCs[g];
+		group[g].dirs = groupDirs[g];
+		group[g].n = n;
+	}
+	srand(1);
+}
+
+void PREDICTOR_BENCH::measure(const char *name, benchFn fn){
+	double *ns = new double[reps];
+	double *cycles = new double[reps];
+	(this->*fn)(ops); //untimed pass to settle caches
+	for(UINT32 r = 0; r < reps; r++) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		UINT64 c0 = READ_CYCLES();
+		(this->*fn)(ops);
+		UINT64 c1 = READ_CYCLES();
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		ns[r] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / ops;
+		cycles[r] = (double)(c1 - c0) / ops;
+	}
+	double nsMean = 0, cyclesMean = 0;
+	for(UINT32 r = 0; r < reps; r++) {
+		nsMean += ns[r] / reps;
+		cyclesMean += cycles[r] / reps;
+	}
+	double nsVar = 0, cyclesVar = 0;
+	for(UINT32 r = 0; r < reps; r++) {
+		nsVar += (ns[r] - nsMean) * (ns[r] - nsMean);
+		cyclesVar += (cycles[r] - cyclesMean) * (cycles[r] - cyclesMean);
+	}
+	if(reps > 1) {
+		nsVar /= reps - 1;
+		cyclesVar /= reps - 1;
+	}
+	printf("%s,%u,%u,%.3f,%.3f,%.2f,%.2f\n", name, reps, ops,
+	       nsMean, sqrt(nsVar), cyclesMean, sqrt(cyclesVar));
+	fflush(stdout);
+	delete[] ns;
+	delete[] cycles;
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+void PREDICTOR_BENCH::benchIndex(UINT32 ops){
+	UINT32 x = 0;
+	for(UINT32 k = 0; k < ops; k++) {
+		UINT32 t = k % NUM_TAGE_TABLES;
+		x ^= p->getIndex(pcs[k & (numPcs-1)], t, p->tageTableSize[t], 0);
+	}
+	sink = x;
+}
+
+void PREDICTOR_BENCH::benchTag(UINT32 ops){
+	UINT32 x = 0;
+	for(UINT32 k = 0; k < ops; k++) {
+		UINT32 t = k % NUM_TAGE_TABLES;
+		x ^= p->getTag(pcs[k & (numPcs-1)], t, p->tageTagSize[t]);
+	}
+	sink = x;
+}
+
+void PREDICTOR_BENCH::benchFold(UINT32 ops){
+	for(UINT32 k = 0; k < ops; k++) {
+		p->fold(&p->csrIndex[k % NUM_TAGE_TABLES]);
+	}
+	sink = p->csrIndex[0].val;
+}
+
+void PREDICTOR_BENCH::benchPredict(UINT32 ops){
+	UINT32 x = 0;
+	for(UINT32 k = 0; k < ops; k++) {
+		x += p->GetPrediction(pcs[k & (numPcs-1)]);
+	}
+	sink = x;
+}
+
+//pred is left as set by the last lookup, so every call allocates below BENCH_TABLE
+void PREDICTOR_BENCH::benchUpdateAlloc(UINT32 ops){
+	for(UINT32 k = 0; k < ops; k++) {
+		UINT32 i = k & (numPcs-1);
+		p->UpdatePredictor(pcs[i], dirs[i], !dirs[i], pcs[i] + 64);
+	}
+}
+
+void PREDICTOR_BENCH::benchUpdateNoAlloc(UINT32 ops){
+	for(UINT32 k = 0; k < ops; k++) {
+		UINT32 i = k & (numPcs-1);
+		p->UpdatePredictor(pcs[i], dirs[i], dirs[i], pcs[i] + 64);
+	}
+}
+
+//one pass over the stream, predicting and updating each branch
+void PREDICTOR_BENCH::benchReplay(UINT32 ops){
+	UINT32 x = 0;
+	p->useStream(stream);
+	for(UINT32 k = 0; k < ops; k++) {
+		bool predDir = p->GetPrediction(streamPCs[k]);
+		p->UpdatePredictor(streamPCs[k], streamDirs[k], predDir, streamPCs[k] + 64);
+		x += predDir;
+	}
+	sink = x;
+}
+
+//the loop table's part of each branch of the stream: find the entry, predict, train
+void PREDICTOR_BENCH::benchLoop(UINT32 ops){
+	UINT32 x = 0;
+	for(UINT32 k = 0; k < ops; k++) {
+		UINT32 index = p->loopEntry(streamPCs[k]);
+		loopVal_t entry;
+		p->loopRead(index, &entry);
+		bool loopPred;
+		bool loopUsed = loopLookup(&entry, streamPCs[k], &loopPred);
+		x += loopTrain(&entry, streamPCs[k], streamDirs[k], loopPred, loopUsed);
+		p->loopWrite(index, &entry);
+	}
+	sink = x;
+}
+
+void PREDICTOR_BENCH::benchSequential(UINT32 ops){
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) { //ops branches in total, split evenly
+		group[g].n = ops / BENCH_GROUP;
+		group[g].p->useStream(groupStreams[g]);
+	}
+	runSequential(group, BENCH_GROUP);
+	sink = group[0].miss;
+}
+
+void PREDICTOR_BENCH::benchInterleaved(UINT32 ops){
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) { //ops branches in total, split evenly
+		group[g].n = ops / BENCH_GROUP;
+		group[g].p->useStream(groupStreams[g]);
+	}
+	runInterleaved(group, BENCH_GROUP, BENCH_GROUP);
+	sink = group[0].miss;
+}
+
+//predictions of the same trace from the legacy calls and from tokens with each of
+//CHECK_INFLIGHT branches in flight, updated in order, each on a fresh predictor with the same
+//seed. True if one in flight matches the legacy calls prediction for prediction and, for the
+//default trace of a default build, every miss count is the recorded one.
+bool PREDICTOR_BENCH::checkTokens(UINT32 n){
+	UINT32 *PCs = new UINT32[n];
+	bool *traceDirs = new bool[n];
+	bool *legacy = new bool[n];
+	makeTrace(2468, n, PCs, traceDirs);
+	bool recorded = (n == CHECK_BRANCHES && TAGE_TABLE_GROW == 0);
+	bool ok = true;
+	UINT64 legacyMiss = 0;
+
+	PREDICTOR *q = new PREDICTOR();
+	srand(1);
+	for(UINT32 k = 0; k < n; k++) {
+		legacy[k] = q->GetPrediction(PCs[k]);
+		legacyMiss += (legacy[k] != traceDirs[k]);
+		q->UpdatePredictor(PCs[k], traceDirs[k], legacy[k], PCs[k] + 64);
+	}
+	delete q;
+	printf("check tokens: branches %u legacy miss %llu", n, (unsigned long long)legacyMiss);
+	if(recorded) {
+		printf(" recorded %llu", (unsigned long long)CHECK_MISS[0]);
+		ok = (legacyMiss == CHECK_MISS[0]);
+	}
+	printf(" %s\n", ok ? "ok" : "FAIL");
+
+	for(UINT32 i = 0; i < sizeof(CHECK_INFLIGHT) / sizeof(CHECK_INFLIGHT[0]); i++) {
+		UINT32 depth = CHECK_INFLIGHT[i];
+		predToken_t *tokens = new predToken_t[depth];
+		UINT64 tokenMiss = 0, differ = 0;
+		q = new PREDICTOR();
+		srand(1);
+		for(UINT32 k = 0; k < n + depth; k++) {
+			if(k >= depth) { //the oldest branch in flight resolves
+				UINT32 old = k - depth;
+				q->update(PCs[old], traceDirs[old], &tokens[old % depth], PCs[old] + 64);
+			}
+			if(k < n) {
+				bool predDir = q->predict(PCs[k], &tokens[k % depth]);
+				tokenMiss += (predDir != traceDirs[k]);
+				if(depth == 1)
+					differ += (predDir != legacy[k]);
+			}
+		}
+		delete q;
+		delete[] tokens;
+		bool pass = (differ == 0) && (!recorded || tokenMiss == CHECK_MISS[i]);
+		printf("check tokens: in flight %u token miss %llu differing %llu", depth,
+		       (unsigned long long)tokenMiss, (unsigned long long)differ);
+		if(recorded)
+			printf(" recorded %llu", (unsigned long long)CHECK_MISS[i]);
+		printf(" %s\n", pass ? "ok" : "FAIL");
+		ok = ok && pass;
+	}
+	delete[] PCs;
+	delete[] traceDirs;
+	delete[] legacy;
+	return ok;
+}
+
+//misses of BENCH_GROUP fresh predictors run over their own traces (n branches in total) one
+//after another, and of as many more run interleaved. True if every instance's match.
+bool PREDICTOR_BENCH::checkGroup(UINT32 n){
+	instance_t alone[BENCH_GROUP], mixed[BENCH_GROUP];
+	UINT32 *PCs[BENCH_GROUP];
+	bool *traceDirs[BENCH_GROUP];
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		PCs[g] = new UINT32[n / BENCH_GROUP];
+		traceDirs[g] = new bool[n / BENCH_GROUP];
+		makeTrace(1000 + g, n / BENCH_GROUP, PCs[g], traceDirs[g]);
+		alone[g].p = new PREDICTOR();
+		mixed[g].p = new PREDICTOR();
+		alone[g].PCs = mixed[g].PCs = PCs[g];
+		alone[g].dirs = mixed[g].dirs = traceDirs[g];
+		alone[g].n = mixed[g].n = n / BENCH_GROUP;
+	}
+	runSequential(alone, BENCH_GROUP);
+	runInterleaved(mixed, BENCH_GROUP, BENCH_GROUP);
+
+	UINT64 aloneMiss = 0, mixedMiss = 0, differ = 0;
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		aloneMiss += alone[g].miss;
+		mixedMiss += mixed[g].miss;
+		differ += (alone[g].miss != mixed[g].miss);
+		delete alone[g].p;
+		delete mixed[g].p;
+		delete[] PCs[g];
+		delete[] traceDirs[g];
+	}
+	printf("check group: instances %u branches %u sequential miss %llu interleaved miss %llu differing %llu %s\n",
+	       BENCH_GROUP, n, (unsigned long long)aloneMiss, (unsigned long long)mixedMiss,
+	       (unsigned long long)differ, differ ? "FAIL" : "ok");
+	return differ == 0;
+}
+
+//mispredictions of loop branches that share direct-mapped loop slots CHECK_LOOP_SHARE at a
+//time. Each iteration is followed by a random branch, so TAGE can't count the trips and only a
+//loop entry of their own predicts the exits. Build with each LOOP_WAYS to compare.
+void PREDICTOR_BENCH::checkLoops(UINT32 n){
+	UINT32 loops = (1<<LOOP_TABLE_SIZE) / 4 / CHECK_LOOP_SHARE * CHECK_LOOP_SHARE; //a quarter of the slots
+	UINT32 s = 7;
+	UINT64 branches = 0, loopBranches = 0, loopMiss = 0;
+	PREDICTOR *q = new PREDICTOR();
+	while(branches < n) {
+		s = s * 1664525 + 1013904223;
+		UINT32 l = (s >> 8) % loops;
+		UINT32 PC = BENCH_PC_BASE + (l % (loops / CHECK_LOOP_SHARE)) * 4 +
+		            (l / (loops / CHECK_LOOP_SHARE)) * (4 << LOOP_TABLE_SIZE); //same slot, other tags
+		UINT32 trip = 5 + (l * 37) % 60;
+		for(UINT32 k = 0; k <= trip; k++, branches += 2) {
+			bool dir = k < trip;
+			bool predDir = q->GetPrediction(PC);
+			loopMiss += (predDir != dir);
+			++loopBranches;
+			q->UpdatePredictor(PC, dir, predDir, PC + 64);
+			s = s * 1664525 + 1013904223;
+			UINT32 noisePC = 2 * BENCH_PC_BASE + ((s >> 20) % 16) * 4;
+			bool noiseDir = (s >> 9) & 1;
+			q->UpdatePredictor(noisePC, noiseDir, q->GetPrediction(noisePC), noisePC + 64);
+		}
+	}
+	delete q;
+	printf("check loops: LOOP_WAYS %u loops %u per slot %u loop branches %llu miss %llu\n",
+	       LOOP_WAYS, loops, CHECK_LOOP_SHARE, (unsigned long long)loopBranches, (unsigned long long)loopMiss);
+}
+
+//prints every benchmark's row. False if the interleaved multi run missed differently from
+//the sequential one
+bool PREDICTOR_BENCH::run(){
+	printf("name,reps,ops,ns_per_op,ns_stddev,cycles_per_op,cycles_stddev\n");
+
+	reset();
+	measure("getIndex", &PREDICTOR_BENCH::benchIndex);
+	measure("getTag", &PREDICTOR_BENCH::benchTag);
+	measure("fold", &PREDICTOR_BENCH::benchFold);
+
+	reset();
+	plantLoop();
+	keepPath(0, true);
+	measure("GetPrediction_loop", &PREDICTOR_BENCH::benchPredict);
+
+	reset();
+	plantTage(BENCH_TABLE);
+	keepPath(BENCH_TABLE, false);
+	measure("GetPrediction_tage", &PREDICTOR_BENCH::benchPredict);
+
+	reset();
+	plantTage(NUM_TAGE_TABLES);
+	keepPath(NUM_TAGE_TABLES, false);
+	measure("GetPrediction_bimodal", &PREDICTOR_BENCH::benchPredict);
+
+	reset();
+	plantTage(BENCH_TABLE);
+	keepPath(BENCH_TABLE, false);
+	p->GetPrediction(pcs[0]);
+	measure("UpdatePredictor_alloc", &PREDICTOR_BENCH::benchUpdateAlloc);
+
+	reset();
+	plantTage(BENCH_TABLE);
+	keepPath(BENCH_TABLE, false);
+	p->GetPrediction(pcs[0]);
+	measure("UpdatePredictor_noalloc", &PREDICTOR_BENCH::benchUpdateNoAlloc);
+
+	makeStream();
+	for(UINT32 i = 0; i < sizeof(BENCH_PREFETCH) / sizeof(BENCH_PREFETCH[0]); i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "replay_prefetch_%u", BENCH_PREFETCH[i]);
+		reset();
+		p->setPrefetch(BENCH_PREFETCH[i]);
+		measure(name, &PREDICTOR_BENCH::benchReplay);
+	}
+	for(UINT32 i = 0; i < sizeof(BENCH_DELAY) / sizeof(BENCH_DELAY[0]); i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "replay_delay_%u", BENCH_DELAY[i]);
+		reset();
+		p->setUpdateDelay(BENCH_DELAY[i] + 1);
+		p->updDelay = BENCH_DELAY[i]; //the queue has room for one more, so 0 still runs it
+		measure(name, &PREDICTOR_BENCH::benchReplay);
+	}
+
+	reset();
+	measure("loop_table", &PREDICTOR_BENCH::benchLoop);
+
+	char name[64];
+	UINT64 aloneMiss[BENCH_GROUP];
+	makeGroup();
+	snprintf(name, sizeof(name), "multi_sequential_%u", BENCH_GROUP);
+	measure(name, &PREDICTOR_BENCH::benchSequential);
+	for(UINT32 g = 0; g < BENCH_GROUP; g++)
+		aloneMiss[g] = group[g].miss;
+	makeGroup(); //fresh predictors, so both rows do the same work
+	snprintf(name, sizeof(name), "multi_interleaved_%u", BENCH_GROUP);
+	measure(name, &PREDICTOR_BENCH::benchInterleaved);
+	for(UINT32 g = 0; g < BENCH_GROUP; g++) {
+		if(group[g].miss != aloneMiss[g]) {
+			fprintf(stderr, "instance %u missed %llu interleaved and %llu sequential\n", g,
+			        (unsigned long long)group[g].miss, (unsigned long long)aloneMiss[g]);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv){
+	if(argc > 1 && strcmp(argv[1], "check") == 0) {
+		UINT32 n = (argc > 2) ? atoi(argv[2]) : CHECK_BRANCHES;
+		if(n == 0) {
+			fprintf(stderr, "usage: %s check [branches]\n", argv[0]);
+			return 1;
+		}
+		PREDICTOR_BENCH bench(1, 1);
+		bool ok = bench.checkTokens(n);
+		ok = bench.checkGroup(n) && ok;
+		bench.checkLoops(n);
+		return ok ? 0 : 1;
+	}
+	UINT32 reps = (argc > 1) ? atoi(argv[1]) : BENCH_REPS;
+	UINT32 ops = (argc > 2) ? atoi(argv[2]) : BENCH_OPS;
+	if(reps == 0 || ops == 0) {
+		fprintf(stderr, "usage: %s [reps] [ops]\n", argv[0]);
+		return 1;
+	}
+	PREDICTOR_BENCH bench(reps, ops);
+	return bench.run() ? 0 : 1;
+}
@@ -1,9 +1,16 @@
 //Jayson Boubin, Dec 2017
-#include "predictor.h"
+#include "LTAGE-final.h"
 #include <cstdlib>
 #include <time.h>
 #include <bitset>
 #include <fstream>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "storageBudget.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #define BIMODAL_SIZE      13  //2^13 rows of 2bit counters
 //#define TAGE_TABLE_SIZE   12  //2^12 rows of 16 bits
@@ -34,9 +41,9 @@
 #define WEAKLY_TAKEN      4   
 #define WEAKLY_NOT_TAKEN  3
 
-#define NUM_TAGE_TABLES   12  //number of tables
 
-#define LOOP_TABLE_SIZE   10  //2^7 entries
+#define LOOP_TABLE_SIZE   10  //2^10 entries
+#define LOOP_WAYS         1   //1 for a direct-mapped table of loopVal_t, up to 8 for sets of packed entries in one cache line
 #define LOOP_TAG_SIZE     14  //14 bit tag
 #define LOOP_CONF_MAX     3   //2 bit confidence 
 #define LOOP_IT_MAX       14  //2^14 max iteration count
@@ -47,25 +54,169 @@
 
 #define PHR_LEN           16  //len of path history
 
+#define STREAM_WARMUP     (HIST_1 + 1) //branches a stream chunk replays so its CSRs and PHR match the whole trace's
+#define STREAM_MAGIC      0x5347544c   //"LTGS", first word of a saved index stream
+#define PREFETCH_DISTANCE 0   //branches ahead to prefetch tagged rows when they're precomputed, 0 for none
+
+#define SPEC_HISTORY      0   //1 to update history at prediction time and repair it on a mispredict, 0 to update it in UpdatePredictor
+#define SPEC_HIST_SIZE    2048 //bits in the speculative history ring (power of 2)
+#define SPEC_MAX_INFLIGHT 256 //checkpoints in the ring, the most branches that can be in flight
+
+#define SMT_HIST_SIZE     1024 //bits in each hardware thread's history ring once setThreads() shares the tables
+
+#define ORACLE_MAP_LOG    16  //2^16 slots each oracle table starts with, doubled whenever it's 3/4 full
+#define ORACLE_HIST_MULT  0x9E3779B97F4A7C15ULL //odd multiplier of the oracle's rolling history hashes
+
+#define UPDATE_DELAY      0   //branches before an update's table writes land, 0 to write immediately
+
+#define SC                0   //1 to add the statistical corrector after TAGE, 0 for plain LTAGE
+#define SC_LOG_SIZE       8   //2^8 weights per GEHL table
+#define SC_BIAS_LOG       6   //2^6 PCs in the bias table, one weight per TAGE direction each
+#define SC_WEIGHT_MAX     31  //6 bit signed weights, stored as int8
+#define SC_THRESHOLD_INIT 10  //|sum| needed to override TAGE, adapted as it runs
+#define SC_THRESHOLD_BITS 8   //bits of the threshold
+#define SC_TC_MAX         31  //6 bit signed counter that moves the threshold
+
+#define ITTAGE            0   //1 to predict indirect branch targets from TrackOtherInst (see IT_STATS), 0 to leave them alone
+#define IT_TABLE_LOG      8   //2^8 entries per tagged target table
+#define IT_TAG_BITS       9   //9 tag bits
+#define IT_BASE_LOG       9   //2^9 PC indexed targets
+#define IT_OFFSET_BITS    12  //target bits kept in each entry, the rest come from its region
+#define IT_REGION_LOG     6   //2^6 regions of high target bits
+#define IT_CTR_MAX        3   //2 bit confidence
+#define IT_CLOCK_MAX      18  //u bits are cleared every 2^18 indirect branches
+#define IT_STATS          0   //1 if you want indirect target MPKI in ittage.txt, 0 if you don't
+#define IT_INTERVAL       (1<<22) //instructions between target reports
+#define IT_STORAGE_BUDGET (8*1024*8) //8KB for indirect targets, on top of STORAGE_BUDGET
+
+#define BTB_LRU           0   //BTB replacement policies
+#define BTB_FIFO          1
+#define BTB_RANDOM        2
+
+#define FRONTEND          0   //1 to model the BTB and RAS and count fetch redirects in frontend.txt, 0 if you don't
+#define FRONTEND_INTERVAL (1<<22) //instructions between frontend reports
+#define BTB_SETS_LOG      9   //2^9 sets
+#define BTB_WAYS          8   //ways per set, a multiple of 4 up to 32
+#define BTB_TAG_BITS      16  //partial tag bits
+#define BTB_POLICY        BTB_LRU //which way a fill replaces when none is empty
+#define RAS_DEPTH         16  //return addresses on the stack
+#define RAS_CALL_BYTES    16  //the trace has no instruction lengths, a return counts as predicted when it
+                              //lands within this many bytes after the call on top of the stack
+
+#define OVERRIDE          0   //1 to count the full prediction overriding a fast bimodal one in override.txt, 0 if you don't
+#define OVERRIDE_INTERVAL (1<<22) //branches between override reports
+#define OVERRIDE_BUBBLE   3   //fetch cycles an override throws away, the full prediction's latency less the bimodal's
+#define MISPREDICT_PENALTY 20 //cycles a mispredict costs, what an override that fixes one saves
+
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr)
+#endif
+
 #define CLOCK_MAX         20  //2^CLOCK_MAX = number of cycles before reset
 
 #define LOG 0 //1 if you want logs, 0 if you don't
 
+#define SNAPSHOT          0   //1 if you want occupancy snapshots in snapshot.txt, 0 if you don't
+#define SNAPSHOT_INTERVAL (1<<20) //branches between snapshots
+#define SNAPSHOT_SAMPLES  64  //entries sampled per table for each snapshot
+
+#define ALIAS             0   //1 if you want tag aliasing stats in alias.txt, 0 if you don't
+#define ALIAS_INTERVAL    (1<<22) //branches between alias reports
+
+#define CONF_STATS        0   //1 if you want misprediction rates per confidence class in confidence.txt, 0 if you don't
+#define CONF_INTERVAL     (1<<22) //branches between confidence reports
+
+#define STORAGE_BUDGET    BUDGET_32KB //32KB class, modelled bits are checked against it at compile time
+#define STORAGE_REPORT    0   //1 if you want modelled bits and host bytes printed at startup, 0 if you don't
+
 /////////////// STORAGE BUDGET JUSTIFICATION //////////////////////////////////////////////////
-// Binomial table: 2^13 2-bit counters = 16Kb
-// TAGE tables: 221.5Kb (math is near initialization)
-// Loop predictor: 2^9 entries of size 42 bits = 21.5Kb 
-// Bimodal + TAGE + Loop = 259Kb/8 = 32.3KB
-/////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////
+// Derived from the configuration by the accountant below and checked against STORAGE_BUDGET:
+// Bimodal table: 2^BIMODAL_SIZE counters of BIMODAL_PRED_SIZE bits
+// TAGE tables: 2^TAGE_TABLE_BITS[i] entries of TAGE_TAG_BITS[i] tag + 3 counter + 2 u bits
+// Loop predictor: 2^LOOP_TABLE_SIZE entries of LOOP_ENTRY_BITS, however many ways they're split into
+// History: GHR up to the longest history, PHR, folded CSRs, altBetterCount and the u clock
+// Corrector (if SC is set): NUM_SC_TABLES tables of 2^SC_LOG_SIZE weights, the bias table,
+//   its history and threshold
+// Indirect targets (if ITTAGE is set, checked against IT_STORAGE_BUDGET): NUM_IT_TABLES tables
+//   of 2^IT_TABLE_LOG tagged entries, 2^IT_BASE_LOG base entries, 2^IT_REGION_LOG regions
+// Frontend (if FRONTEND is set, reported but not budgeted): 2^BTB_SETS_LOG sets of BTB_WAYS
+//   entries of tag, valid, target and replacement bits, RAS_DEPTH return addresses
+// Set STORAGE_REPORT to 1 for the totals and the host bytes they really take
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace ltageFinal {
+
+//size (log2 entries) and tag bits of each TAGE table, longest history first
+constexpr UINT32 TAGE_TABLE_BITS[NUM_TAGE_TABLES] = {9, 9, 10, 10, 10, 10, 10, 10, 10, 11, 10, 10};
+//log2 growth of every TAGE table past the sizes above. Only for studying tables far larger than
+//the caches (LTAGE-bench's large build sets it); a grown predictor is not held to the budget
+#ifndef TAGE_TABLE_GROW
+#define TAGE_TABLE_GROW   0
+#endif
+constexpr UINT32 TAGE_TAG_BITS[NUM_TAGE_TABLES]   = {15, 14, 13, 12, 12, 11, 10, 9, 8, 8, 8, 7};
+constexpr UINT32 TAGE_HIST_LENS[NUM_TAGE_TABLES]  = {HIST_1, HIST_2, HIST_3, HIST_4, HIST_5, HIST_6,
+                                                     HIST_7, HIST_8, HIST_9, HIST_10, HIST_11, HIST_12};
+//global history bits each GEHL table of the corrector folds into its index
+constexpr UINT32 SC_HIST_LENS[NUM_SC_TABLES] = {0, 3, 8, 20};
+constexpr UINT32 SC_WEIGHTS = (NUM_SC_TABLES << SC_LOG_SIZE) + (2 << SC_BIAS_LOG); //GEHL tables then bias
+static_assert(NUM_SC_TABLES + 1 <= 8, "the corrector's sum gathers at most 8 weights at once");
+static_assert(SC_HIST_LENS[NUM_SC_TABLES-1] <= 64, "the corrector's history is 64 bits");
+//TAGE table whose history (and CSRs) each indirect target table hashes with, longest first
+constexpr UINT32 IT_TAGE_TABLE[NUM_IT_TABLES] = {1, 3, 5, 7, 9, 11};
+static_assert(IT_OFFSET_BITS < 32 && IT_OFFSET_BITS <= 16, "target offsets are 16 bit");
+static_assert(IT_REGION_LOG <= 8, "region numbers are 8 bit");
+static_assert(BTB_WAYS % 4 == 0 && BTB_WAYS <= 32, "BTB ways are compared 4 at a time into a 32 bit mask");
+static_assert(BTB_TAG_BITS < 32, "BTB tags keep 0 for an empty way");
+static_assert(STREAM_WARMUP >= PHR_LEN, "stream chunks must replay the whole path history");
+static_assert(SPEC_HIST_SIZE > HIST_1 + SPEC_MAX_INFLIGHT, "speculative bits would overwrite history still in use");
+static_assert(SMT_HIST_SIZE > HIST_1, "a thread's ring must hold its longest history");
+
+//modelled hardware bits of each component
+constexpr UINT64 BIMODAL_BITS = tableBits(BIMODAL_SIZE, BIMODAL_PRED_SIZE);
+constexpr UINT64 TAGE_BITS = taggedTableBits(TAGE_TABLE_BITS, TAGE_TAG_BITS,
+                                             TAGE_PRED_SIZE + bitsFor(PRED_U_MAX), NUM_TAGE_TABLES) << TAGE_TABLE_GROW;
+constexpr UINT64 LOOP_ENTRY_BITS = LOOP_TAG_SIZE +                   //tag
+                                   2 * bitsFor(1<<LOOP_IT_MAX) +       //loop count, current iteration
+                                   bitsFor(LOOP_CONF_MAX) +            //confidence
+                                   bitsFor((1<<LOOP_AGE_MAX) + 1) + 2; //age, pred and used
+constexpr UINT64 LOOP_BITS = tableBits(LOOP_TABLE_SIZE, LOOP_ENTRY_BITS);
+//fields of a packed loop entry, low bits first
+constexpr UINT32 LOOP_CNT_BITS = bitsFor(1<<LOOP_IT_MAX);
+constexpr UINT32 LOOP_AGE_BITS = bitsFor((1<<LOOP_AGE_MAX) + 1);
+constexpr UINT32 LOOP_COUNT_SHIFT = LOOP_TAG_SIZE;
+constexpr UINT32 LOOP_ITER_SHIFT = LOOP_COUNT_SHIFT + LOOP_CNT_BITS;
+constexpr UINT32 LOOP_CONF_SHIFT = LOOP_ITER_SHIFT + LOOP_CNT_BITS;
+constexpr UINT32 LOOP_AGE_SHIFT = LOOP_CONF_SHIFT + bitsFor(LOOP_CONF_MAX);
+constexpr UINT32 LOOP_PRED_SHIFT = LOOP_AGE_SHIFT + LOOP_AGE_BITS;
+constexpr UINT32 LOOP_USED_SHIFT = LOOP_PRED_SHIFT + 1;
+static_assert(LOOP_ENTRY_BITS <= 64, "a packed loop entry is one 64 bit word");
+static_assert((LOOP_WAYS & (LOOP_WAYS - 1)) == 0 && LOOP_WAYS <= 8 && LOOP_WAYS <= (1<<LOOP_TABLE_SIZE),
+              "a loop set is a power of 2 ways that fits in one 64 byte line");
+constexpr UINT64 HISTORY_BITS = (HIST_1 + 1) + PHR_LEN +               //GHR and PHR
+                                3 * sumBits(TAGE_TAG_BITS, NUM_TAGE_TABLES) - NUM_TAGE_TABLES + //CSRs
+                                bitsFor(ALTPRED_BET_MAX) + CLOCK_MAX + 1; //altBetterCount and clock
+constexpr UINT64 SC_BITS = SC ? (UINT64)SC_WEIGHTS * (bitsFor(SC_WEIGHT_MAX) + 1) + //weights
+                                 SC_HIST_LENS[NUM_SC_TABLES-1] +                 //its history
+                                 SC_THRESHOLD_BITS + bitsFor(SC_TC_MAX) + 1 : 0; //threshold and counter
+constexpr UINT64 TOTAL_BITS = BIMODAL_BITS + TAGE_BITS + LOOP_BITS + HISTORY_BITS + SC_BITS;
+static_assert(TOTAL_BITS <= STORAGE_BUDGET || TAGE_TABLE_GROW > 0, "LTAGE-final is over its storage budget");
+constexpr UINT64 IT_TARGET_BITS = IT_OFFSET_BITS + IT_REGION_LOG + bitsFor(IT_CTR_MAX);  //target and confidence
+constexpr UINT64 IT_BITS = NUM_IT_TABLES * tableBits(IT_TABLE_LOG, IT_TAG_BITS + IT_TARGET_BITS + 1) + //tagged, 1 u bit
+                           tableBits(IT_BASE_LOG, IT_TARGET_BITS) +                  //base table
+                           tableBits(IT_REGION_LOG, 32 - IT_OFFSET_BITS) +           //regions
+                           IT_REGION_LOG + IT_CLOCK_MAX;                             //replacement pointer and clock
+static_assert(IT_BITS <= IT_STORAGE_BUDGET, "LTAGE-final's indirect target predictor is over its budget");
+constexpr UINT64 BTB_BITS = tableBits(BTB_SETS_LOG, BTB_WAYS * (BTB_TAG_BITS + 1 + 32 + bitsFor(BTB_WAYS - 1)));
+constexpr UINT64 RAS_BITS = RAS_DEPTH * 32 + 2 * bitsFor(RAS_DEPTH);         //addresses, top and count
+
 void initLog(){
         if(LOG)
                 std::remove("log.txt");
 }
 
-void log(std::string output){
+void log(const char *output){
         if(LOG) {
                 std::ofstream out;
                 out.open("log.txt", std::ios::app);
@@ -73,7 +224,7 @@ void log(std::string output){
         }
 }
 template <typename T>
-void log(std::string output, T i){
+void log(const char *output, T i){
         if(LOG){
                 std::ofstream out;
                 out.open("log.txt", std::ios::app);
@@ -81,6 +232,204 @@ void log(std::string output, T i){
         }
 }
 
+//hashes and history shared by PREDICTOR and INDEX_STREAM so both always agree
+static inline UINT32 hashTag(UINT32 PC, UINT32 csrTag0, UINT32 csrTag1, UINT32 tagSize) {
+        UINT32 tag = (PC ^ csrTag0 ^ (csrTag1 << 1));
+        return (tag & ((1 << tagSize) -1));
+}
+
+static inline UINT32 hashIndex(UINT32 PC, UINT32 csrIndex, UINT32 PHR, UINT32 tagSize, UINT32 phrOffset) {
+	UINT32 index = PC ^ (PC >> tagSize) ^ csrIndex ^ PHR ^ (PHR & ((1<<phrOffset)-1));
+	return (index & ((1 << tagSize)-1));
+}
+
+//shift newest into a CSR and drop oldest, the bit origLen branches back
+static inline void foldBits(csr_t *shift, UINT32 newest, UINT32 oldest) {
+        shift->val = (shift->val << 1) + newest;
+        shift->val ^= ((shift->val & (1 << shift->newLen)) >> shift->newLen);
+	shift->val ^= (oldest << (shift->origLen % shift->newLen));
+	shift->val &= ((1 << shift->newLen) -1);
+}
+
+static inline void foldHistory(csr_t *shift, const bitset<1001> &GHR) {
+	foldBits(shift, GHR[0], GHR[shift->origLen]);
+}
+
+static inline UINT32 pathHistory(UINT32 PHR, UINT32 PC) {
+    	PHR = (PHR << 1);
+    	if(PC & 1) {
+       		PHR = PHR + 1;
+    	}
+    	return (PHR & ((1 << PHR_LEN) - 1));
+}
+
+//loop predictor lookup, shared by PREDICTOR and the component studies. Puts the entry's
+//prediction in loopPred (its last one if the loop isn't running) and returns true if the
+//entry is confident enough to provide it. Nothing is written, loopTrain() records both.
+static inline bool loopLookup(const loopVal_t *entry, UINT32 PC, bool *loopPred) {
+	UINT32 loopTag = (PC) % (1<<LOOP_TAG_SIZE);
+	*loopPred = entry->pred;
+	if(entry->tag == loopTag &&
+	   entry->currentIter < entry->loopCount){ //if the loop is executing
+		*loopPred = TAKEN;
+	} else if(entry->tag == loopTag &&
+		  entry->currentIter == entry->loopCount) { //if loop is over
+		*loopPred = NOT_TAKEN;
+	} 
+	if(entry->tag == loopTag &&
+	   entry->conf == LOOP_CONF_MAX) { //if loop predictor is confident
+		return true;
+	}
+	return false;
+}
+
+//a loop entry to and from its packed 64 bit form
+static inline void loopUnpack(UINT64 word, loopVal_t *entry) {
+	entry->tag = word & ((1<<LOOP_TAG_SIZE) - 1);
+	entry->loopCount = (word >> LOOP_COUNT_SHIFT) & ((1<<LOOP_CNT_BITS) - 1);
+	entry->currentIter = (word >> LOOP_ITER_SHIFT) & ((1<<LOOP_CNT_BITS) - 1);
+	entry->conf = (word >> LOOP_CONF_SHIFT) & LOOP_CONF_MAX;
+	entry->age = (word >> LOOP_AGE_SHIFT) & ((1<<LOOP_AGE_BITS) - 1);
+	entry->pred = (word >> LOOP_PRED_SHIFT) & 1;
+	entry->used = (word >> LOOP_USED_SHIFT) & 1;
+}
+
+static inline UINT64 loopPack(const loopVal_t *entry) {
+	return (UINT64)entry->tag | ((UINT64)entry->loopCount << LOOP_COUNT_SHIFT) |
+	       ((UINT64)entry->currentIter << LOOP_ITER_SHIFT) | ((UINT64)entry->conf << LOOP_CONF_SHIFT) |
+	       ((UINT64)entry->age << LOOP_AGE_SHIFT) | ((UINT64)entry->pred << LOOP_PRED_SHIFT) |
+	       ((UINT64)entry->used << LOOP_USED_SHIFT);
+}
+
+//loop predictor training, given what loopLookup() said for this branch. Returns true if the
+//entry provided the prediction, in which case the other tables are left alone.
+static inline bool loopTrain(loopVal_t *entry, UINT32 PC, bool resolveDir, bool loopPred, bool loopUsed) {
+	entry->pred = loopPred;
+	entry->used = loopUsed;
+	UINT32 loopTag = (PC) % (1<<LOOP_TAG_SIZE);
+	if(entry->tag != loopTag && entry->age > 0){ //if tag miss
+		--(entry->age); //decrease age
+	} else { //if tag hit:
+		if(entry->age == 0){ //if entry is old or blank
+			//initialize a new entry
+			entry->tag = (PC) % (1<<LOOP_TAG_SIZE);
+			entry->age = (1<<LOOP_AGE_MAX) + 1;
+			entry->currentIter = 1;
+			entry->loopCount = (1<<LOOP_IT_MAX); 
+			entry->conf = 0;
+			entry->pred = 0;
+		} else {
+			if(entry->pred == resolveDir) { //prediction was correct
+				if(entry->currentIter != entry->loopCount){
+					++(entry->currentIter);
+				} else if(entry->currentIter == entry->loopCount){
+					entry->currentIter = 0;
+					if(entry->conf < LOOP_CONF_MAX)
+						++(entry->conf);
+				}
+			} else { //prediction was incorrect
+				if(entry->age >= (1<<LOOP_AGE_MAX)) { //still as allocated (or aged once), the first exit gives the trip count
+					entry->loopCount = entry->currentIter;
+					entry->currentIter = 0;
+					entry->conf = 1;
+				} else {
+					entry->loopCount = 0;
+					entry->currentIter = 0;
+					entry->tag = 0;
+					entry->conf = 0;
+					entry->age = 0;
+					entry->pred = false;
+				}
+			}
+		}
+		if(entry->used){
+			return true;
+		}
+	}
+	return false;
+}
+
+//confidence of a TAGE provider: medium if its counter is saturated, low otherwise. A branch
+//only has a provider after mispredicting, so even saturated ones miss more than the bimodal
+//table's (and the u bits made no difference when measured).
+static inline int tageConf(const tagVal_t *entry) {
+	return (entry->pred == 0 || entry->pred == TAGE_PRED_MAX) ? CONF_MEDIUM : CONF_LOW;
+}
+
+//confidence of a bimodal prediction: high if saturated, low otherwise
+static inline int bimodalConf(const bimodVal_t *entry) {
+	return (entry->pred == 0 || entry->pred == BIMODAL_PRED_MAX) ? CONF_HIGH : CONF_LOW;
+}
+
+//index into a GEHL table from the PC and the newest histLen bits of the corrector's history
+static inline UINT32 scHash(UINT32 PC, UINT64 hist, UINT32 histLen) {
+	if(histLen < 64)
+		hist &= ((UINT64)1 << histLen) - 1;
+	UINT32 index = PC ^ (PC >> SC_LOG_SIZE);
+	for(; hist; hist >>= SC_LOG_SIZE)
+		index ^= (UINT32)hist;
+	return index & ((1 << SC_LOG_SIZE) - 1);
+}
+
+//sum of 2w+1 over the weights the corrector picked. With AVX2 they're gathered at once: each
+//lane loads the 4 bytes at its weight (the array is padded so the last one can) and keeps the
+//low one, spare lanes read the zero past the end.
+static inline int scSumWeights(const int8_t *weights, const UINT16 *index) {
+#if defined(__AVX2__)
+	alignas(32) INT32 lanes[8];
+	for(int i = 0; i < 8; i++)
+		lanes[i] = (i <= NUM_SC_TABLES) ? index[i] : SC_WEIGHTS;
+	__m256i w = _mm256_i32gather_epi32((const int *)weights, _mm256_load_si256((const __m256i *)lanes), 1);
+	w = _mm256_srai_epi32(_mm256_slli_epi32(w, 24), 24);
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+	sum = _mm_hadd_epi32(sum, sum);
+	sum = _mm_hadd_epi32(sum, sum);
+	return 2 * _mm_cvtsi128_si32(sum) + NUM_SC_TABLES + 1;
+#else
+	int sum = 0;
+	for(int i = 0; i <= NUM_SC_TABLES; i++)
+		sum += 2 * weights[index[i]] + 1;
+	return sum;
+#endif
+}
+
+//mask of the ways of a BTB set whose tag is tag. With SSE2 (any x86-64) ways are compared 4 at a
+//time, with AVX2 8 at a time.
+static inline UINT32 btbMatch(const UINT32 *tags, UINT32 tag) {
+	UINT32 mask = 0;
+	int w = 0;
+#if defined(__AVX2__)
+	__m256i t8 = _mm256_set1_epi32(tag);
+	for(; w + 8 <= BTB_WAYS; w += 8) {
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)&tags[w]), t8);
+		mask |= (UINT32)_mm256_movemask_ps(_mm256_castsi256_ps(eq)) << w;
+	}
+#endif
+#if defined(__SSE2__)
+	__m128i t4 = _mm_set1_epi32(tag);
+	for(; w < BTB_WAYS; w += 4) {
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)&tags[w]), t4);
+		mask |= (UINT32)_mm_movemask_ps(_mm_castsi128_ps(eq)) << w;
+	}
+#endif
+	for(; w < BTB_WAYS; w++) {
+		mask |= (UINT32)(tags[w] == tag) << w;
+	}
+	return mask;
+}
+
+static inline bool bimodalPredict(const bimodVal_t *entry) {
+	return (entry->pred > BIMODAL_PRED_MAX/2);
+}
+
+static inline void bimodalTrain(bimodVal_t *entry, bool resolveDir) {
+	if(resolveDir && entry->pred < BIMODAL_PRED_MAX) {
+		++(entry->pred);
+	} else if(!resolveDir && entry->pred > 0) {
+		--(entry->pred);
+	}
+}
+
 PREDICTOR::PREDICTOR(void)
 {
  	//init logs for debugging. Only works if LOG isn't 0
@@ -91,35 +440,14 @@ PREDICTOR::PREDICTOR(void)
    	log("attempting to make new var");
 	
 	GHR = new bitset<1001>;
+	historyShared = false;
 
 	tageTableSize = new UINT32[NUM_TAGE_TABLES];
-	tageTableSize[0] = 9;  //10Kb
-	tageTableSize[1] = 9;  //9.5Kb
-	tageTableSize[2] = 10; //18Kb 
-	tageTableSize[3] = 10; //17Kb
-	tageTableSize[4] = 10; //17Kb
-	tageTableSize[5] = 10; //16Kb
-	tageTableSize[6] = 11; //30Kb
-	tageTableSize[7] = 11; //28Kb
-	tageTableSize[8] = 11; //26Kb
-	tageTableSize[9] = 11; //26Kb
-	tageTableSize[10] = 10;//12Kb
-	tageTableSize[11] = 10;//12Kb
-			       //= 221.5K bits 
 	tageTagSize = new UINT32[NUM_TAGE_TABLES];
-	tageTagSize[0] = 15;
-	tageTagSize[1] = 14;
-	tageTagSize[2] = 13;
-	tageTagSize[3] = 12;
-	tageTagSize[4] = 12;
-	tageTagSize[5] = 11;
-	tageTagSize[6] = 10;
-	tageTagSize[7] = 9;
-	tageTagSize[8] = 8;
-	tageTagSize[9] = 8;
-	tageTagSize[10] = 8;
-	tageTagSize[11] = 7;
-
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+		tageTableSize[i] = TAGE_TABLE_BITS[i] + TAGE_TABLE_GROW;
+		tageTagSize[i] = TAGE_TAG_BITS[i];
+	}
 
 	log("to tag init");
 	tagTables = new tagVal_t*[NUM_TAGE_TABLES];
@@ -148,32 +476,35 @@ PREDICTOR::PREDICTOR(void)
      	}
 	
 	loopTableSize = (1<<LOOP_TABLE_SIZE);
-	loopTable = new loopVal_t[loopTableSize];
-	for(UINT32 i = 0; i<loopTableSize; i++){
-		loopTable[i].loopCount = 0;  //2 bits
-		loopTable[i].currentIter = 0;//14 bits
-		loopTable[i].tag = 0;        //14 bits
-		loopTable[i].conf = 0;       //2 bits
-		loopTable[i].age = 0;        //8 bits     
-		loopTable[i].pred = false;   //1 bit
-		loopTable[i].used = false;   //1 bit
-					     //42 bits * 2^9 entries = 21Kb
+	loopSets = loopTableSize / LOOP_WAYS;
+	loopTable = NULL;
+	loopPacked = NULL;
+	loopPackedAlloc = NULL;
+	if(LOOP_WAYS == 1) {
+		loopTable = new loopVal_t[loopTableSize];
+		for(UINT32 i = 0; i<loopTableSize; i++){
+			loopTable[i].loopCount = 0;  //15 bits
+			loopTable[i].currentIter = 0;//15 bits
+			loopTable[i].tag = 0;        //14 bits
+			loopTable[i].conf = 0;       //2 bits
+			loopTable[i].age = 0;        //9 bits
+			loopTable[i].pred = false;   //1 bit
+			loopTable[i].used = false;   //1 bit
+						     //= LOOP_ENTRY_BITS
+		}
+	} else { //empty packed entries are all zeros, aligned so a set never straddles two lines
+		loopPackedAlloc = new char[loopTableSize * sizeof(UINT64) + 63];
+		loopPacked = (UINT64 *)(((uintptr_t)loopPackedAlloc + 63) & ~(uintptr_t)63);
+		for(UINT32 i = 0; i < loopTableSize; i++) {
+			loopPacked[i] = 0;
+		}
 	}
 	log("to hist init");
     	//initialize geometric history lengths for TAGE tables
 	tageHistory = new UINT32[NUM_TAGE_TABLES]; 
-    	tageHistory[0] = HIST_1;
-    	tageHistory[1] = HIST_2;
-    	tageHistory[2] = HIST_3;
-    	tageHistory[3] = HIST_4;
-	tageHistory[4] = HIST_5;
-    	tageHistory[5] = HIST_6;
-    	tageHistory[6] = HIST_7;
-    	tageHistory[7] = HIST_8;
-	tageHistory[8] = HIST_9;
-    	tageHistory[9] = HIST_10;
-    	tageHistory[10] = HIST_11;
-    	tageHistory[11] = HIST_12;
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+		tageHistory[i] = TAGE_HIST_LENS[i];
+	}
 	
     	log("done hist init");
 	//create circular shift registers
@@ -204,15 +535,223 @@ PREDICTOR::PREDICTOR(void)
        	for(UINT32 i=0; i < NUM_TAGE_TABLES; i++) {    
             	tageTag[i] = 0;
        	}
+	//init loop lookup results
+	loopPred = false;
+	loopUsed = false;
+	conf = CONF_LOW;
+	//init the statistical corrector, its weights are only allocated when it's used
+	for(int i = 0; i <= NUM_SC_TABLES; i++) {
+		scIndex[i] = 0;
+	}
+	scSum = 0;
+	tagePred = false;
+	scWeights = NULL;
+	scThreshold = SC_THRESHOLD_INIT;
+	scThresholdCtr = 0;
+	//init the indirect target predictor, only allocated when it's used
+	itTables = NULL;
+	itBase = NULL;
+	itRegions = NULL;
+	itRegionNext = 0;
+	itClock = 0;
+	insts = 0;
+	itIndirect = 0;
+	itMiss = 0;
+	if(ITTAGE) {
+		itTables = new targetVal_t*[NUM_IT_TABLES];
+		for(int i = 0; i < NUM_IT_TABLES; i++) {
+			itTables[i] = new targetVal_t[1 << IT_TABLE_LOG];
+			for(UINT32 j = 0; j < (1 << IT_TABLE_LOG); j++) {
+				itTables[i][j].tag = 0;
+				itTables[i][j].offset = 0;
+				itTables[i][j].region = 0;
+				itTables[i][j].ctr = 0;
+				itTables[i][j].u = 0;
+			}
+		}
+		itBase = new targetVal_t[1 << IT_BASE_LOG];
+		for(UINT32 j = 0; j < (1 << IT_BASE_LOG); j++) {
+			itBase[j].tag = 0;
+			itBase[j].offset = 0;
+			itBase[j].region = 0;
+			itBase[j].ctr = 0;
+			itBase[j].u = 0;
+		}
+		itRegions = new UINT32[1 << IT_REGION_LOG];
+		for(UINT32 j = 0; j < (1 << IT_REGION_LOG); j++) {
+			itRegions[j] = 0;
+		}
+	}
+	if(IT_STATS)
+		std::remove("ittage.txt");
+	//init the frontend model, only allocated when it's used
+	btbTag = NULL;
+	btbTarget = NULL;
+	btbStamp = NULL;
+	btbTick = 0;
+	btbSeed = 1;
+	rasStack = NULL;
+	rasTop = 0;
+	rasCount = 0;
+	btbLookups = 0;
+	btbHits = 0;
+	rasPops = 0;
+	rasRight = 0;
+	rasOverflow = 0;
+	rasUnderflow = 0;
+	for(int i = 0; i < NUM_REDIRECT_CAUSES; i++) {
+		redirects[i] = 0;
+	}
+	//init the fast table and the override counts. TAGE's bimodal only trains when no tagged entry
+	//provides, so it can't stand in for a first stage predictor that sees every branch.
+	fastTable = NULL;
+	if(OVERRIDE) {
+		fastTable = new bimodVal_t[numBimodalEntries];
+		for(UINT32 i = 0; i < numBimodalEntries; i++) {
+			fastTable[i].pred = BIMODAL_PRED_INIT;
+		}
+	}
+	fastPred = false;
+	ovBubble = OVERRIDE_BUBBLE;
+	ovPenalty = MISPREDICT_PENALTY;
+	ovBranches = 0;
+	ovOverrides = 0;
+	ovFixed = 0;
+	ovBroke = 0;
+	fastMiss = 0;
+	slowMiss = 0;
+	if(FRONTEND) {
+		UINT32 btbEntries = (1 << BTB_SETS_LOG) * BTB_WAYS;
+		btbTag = new UINT32[btbEntries];
+		btbTarget = new UINT32[btbEntries];
+		btbStamp = new UINT32[btbEntries];
+		for(UINT32 i = 0; i < btbEntries; i++) {
+			btbTag[i] = 0;
+			btbTarget[i] = 0;
+			btbStamp[i] = 0;
+		}
+		rasStack = new UINT32[RAS_DEPTH];
+		for(UINT32 i = 0; i < RAS_DEPTH; i++) {
+			rasStack[i] = 0;
+		}
+		std::remove("frontend.txt");
+	}
+	if(SC) {
+		scWeights = new int8_t[SC_WEIGHTS + 4]; //+4 so a gather can load 4 bytes at the last weight
+		for(UINT32 i = 0; i < SC_WEIGHTS + 4; i++) {
+			scWeights[i] = 0;
+		}
+	}
 	//init clock
        	clock = 0;
        	clockState = 0;
+	//thread 0 runs on the history above until setThreads() adds more
+	numThreads = 1;
+	thread = 0;
+	threads = new threadCtx_t[1];
+	threads[0].hist = NULL;
+	threads[0].head = 0;
+	threads[0].csrIndex = csrIndex;
+	threads[0].csrTag[0] = csrTag[0];
+	threads[0].csrTag[1] = csrTag[1];
+	threads[0].PHR = 0;
+	threads[0].scGHR = 0;
+	threads[0].insts = 0;
+	threads[0].branches = 0;
+	threads[0].miss = 0;
 	//init path history
-       	PHR = 0;
+       	PHR = &threads[0].PHR;
+	scGHR = &threads[0].scGHR;
 	//init global history
        	GHR->reset();
 	//init alt meta-veriable
        	altBetterCount = ALTPRED_BET_INIT;
+	//init snapshot counters
+	snapBranches = 0;
+	snapCount = 0;
+	snapSeed = 1;
+	snapHits = new UINT32[NUM_TAGE_TABLES];
+	snapAllocs = new UINT32[NUM_TAGE_TABLES];
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+		snapHits[i] = 0;
+		snapAllocs[i] = 0;
+	}
+	if(SNAPSHOT)
+		std::remove("snapshot.txt");
+	//init aliasing shadow tables, only allocated when they're used
+	//init confidence stats
+	confCount = 0;
+	for(int i = 0; i < NUM_CONF_CLASSES; i++) {
+		confBranches[i] = 0;
+		confMiss[i] = 0;
+	}
+	if(CONF_STATS)
+		std::remove("confidence.txt");
+	//init speculative history ring and checkpoints, only allocated when they're used
+	specHist = NULL;
+	specHead = 0;
+	ckpts = NULL;
+	ckptNext = 0;
+	ckpt = 0;
+	if(SPEC_HISTORY) {
+		specHist = new bool[SPEC_HIST_SIZE];
+		for(UINT32 i = 0; i < SPEC_HIST_SIZE; i++) {
+			specHist[i] = false;
+		}
+		ckpts = new histCkpt_t[SPEC_MAX_INFLIGHT];
+	}
+	//init delayed update queue, only allocated when it's used
+	updDelay = 0;
+	updBranches = 0;
+	updQueue = NULL;
+	updQueueSize = 0;
+	updHead = 0;
+	updCount = 0;
+	updPendingTag = NULL;
+	updPendingBimodal = NULL;
+	updPendingLoop = NULL;
+	updPendingSC = NULL;
+	updPendingFast = NULL;
+	updSavedTag = NULL;
+	updStartTag = NULL;
+	if(UPDATE_DELAY)
+		setUpdateDelay(UPDATE_DELAY);
+	aliasBranches = 0;
+	aliasTables = NULL;
+	aliasHist = NULL;
+	aliasStats = NULL;
+	if(ALIAS) {
+		std::remove("alias.txt");
+		aliasTables = new aliasVal_t*[NUM_TAGE_TABLES];
+		aliasHist = new UINT64[NUM_TAGE_TABLES];
+		aliasStats = new aliasStat_t[NUM_TAGE_TABLES];
+		for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+			UINT32 tableSize = (1<<tageTableSize[i]);
+			aliasTables[i] = new aliasVal_t[tableSize];
+			for(UINT32 j = 0; j < tableSize; j++) {
+				aliasTables[i][j].PC = 0;
+				aliasTables[i][j].hist = 0;
+				aliasTables[i][j].valid = false;
+			}
+			aliasHist[i] = 0;
+			aliasStats[i].hits = 0;
+			aliasStats[i].falsePC = 0;
+			aliasStats[i].falseCtx = 0;
+			aliasStats[i].cold = 0;
+		}
+	}
+	//hash live until useStream() is called
+	rowIndex = NULL;
+	rowTag = NULL;
+	rowCount = 0;
+	rowPos = 0;
+	batchIndex = NULL;
+	batchTag = NULL;
+	batchSize = 0;
+	prefetchDist = PREFETCH_DISTANCE;
+	if(STORAGE_REPORT)
+		reportStorage();
+	allocSeed = 1;
 	//reset random seed
 	srand(time(NULL));
 	log("exit init");
@@ -224,150 +763,387 @@ PREDICTOR::PREDICTOR(void)
 /////////////////////////////////////////////////////////////
 
 bool   PREDICTOR::GetPrediction(UINT32 PC){
+	if(IT_STATS || FRONTEND)
+		++insts;
+	if(numThreads > 1)
+		++threads[thread].insts;
+	if(updQueue) //land the writes that are due before this lookup
+		delayApply(updBranches);
+	predToken_t ctx;
+	bool predDir = lookup(PC, &ctx);
+	//keep what UpdatePredictor needs. TAGE isn't looked up when the loop predictor provides the
+	//prediction, and then the last provider, indices and tags are kept as they always were.
+	loopPred = ctx.loopPred;
+	loopUsed = ctx.loopUsed;
+	conf = ctx.conf;
+	fastPred = ctx.fastPred;
+	if(!ctx.loopUsed) {
+		pred = ctx.pred;
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			tageIndex[i] = ctx.index[i];
+			tageTag[i] = ctx.tag[i];
+		}
+		if(SC) { //only looked up when it's used
+			for(int i = 0; i <= NUM_SC_TABLES; i++) {
+				scIndex[i] = ctx.scIndex[i];
+			}
+			scSum = ctx.scSum;
+			tagePred = ctx.tagePred;
+		}
+	}
+	if(SPEC_HISTORY && !rowIndex) { //checkpoint the history, then assume the prediction is right
+		ckpt = ckptNext;
+		ckptNext = (ckptNext + 1) % SPEC_MAX_INFLIGHT;
+		histCkpt_t *c = &ckpts[ckpt];
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			c->csrIndex[i] = csrIndex[i].val;
+			c->csrTag[0][i] = csrTag[0][i].val;
+			c->csrTag[1][i] = csrTag[1][i].val;
+		}
+		c->PHR = *PHR;
+		c->histHead = specHead;
+		specPush(PC, predDir);
+	}
+	return predDir;
+}
+
+//the prediction itself, from the loop table, TAGE tables or bimodal table. It only reads the
+//predictor, so any number of threads can look up a predictor nobody is updating (with LOG
+//off), and ctx gets everything an update of the branch would need.
+bool   PREDICTOR::lookup(UINT32 PC, predToken_t *ctx) const{
 	log("in pred");
-  	//get bimodal index
+	//precomputed rows say what later branches will read, so start fetching them now
+	if(rowIndex && prefetchDist && rowPos + prefetchDist < rowCount) {
+		const UINT32 *ahead = &rowIndex[(rowPos + prefetchDist) * NUM_TAGE_TABLES];
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			PREFETCH(&tagTables[i][ahead[i]]);
+		}
+	}
+  	//get bimodal index, the fast table shares it
 	UINT32 bimodalIndex = (PC) % (numBimodalEntries);
-	//get loop predictor index
-	UINT32 loopIndex = (PC) % (loopTableSize);  	
+	ctx->fastPred = OVERRIDE ? bimodalPredict(&fastTable[bimodalIndex]) : false;
+	//get loop predictor entry
+	loopVal_t loopVal;
+	loopRead(loopEntry(PC), &loopVal);
 	
 	log("Check loop");
 	//check loop counter
-	UINT32 loopTag = (PC) % (1<<LOOP_TAG_SIZE);
-	if(loopTable[loopIndex].tag == loopTag &&
-	   loopTable[loopIndex].currentIter < loopTable[loopIndex].loopCount){ //if the loop is executing
-		loopTable[loopIndex].pred = TAKEN;
-	} else if(loopTable[loopIndex].tag == loopTag &&
-		  loopTable[loopIndex].currentIter == loopTable[loopIndex].loopCount) { //if loop is over
-		loopTable[loopIndex].pred = NOT_TAKEN;
-	} 
-	if(loopTable[loopIndex].tag == loopTag &&
-	   loopTable[loopIndex].conf == LOOP_CONF_MAX) { //if loop predictor is confident
-		loopTable[loopIndex].used = true;       //use and return
-		return loopTable[loopIndex].pred;
+	ctx->loopUsed = loopLookup(&loopVal, PC, &ctx->loopPred);
+	if(ctx->loopUsed) { //if loop predictor is confident, use and return
+		ctx->predDir = ctx->loopPred;
+		ctx->conf = CONF_HIGH;
+		return ctx->predDir;
 	}
-	//if prediction hasn't been made, used = false
-	loopTable[loopIndex].used = false;
 
 	//else use TAGE
+	if(rowIndex) { //tags and indices were hashed ahead of time
+		if(rowPos >= rowCount) {
+			fprintf(stderr, "trace is longer than its index stream\n");
+			exit(1);
+		}
+		const UINT16 *tagRow = &rowTag[rowPos * NUM_TAGE_TABLES];
+		const UINT32 *indexRow = &rowIndex[rowPos * NUM_TAGE_TABLES];
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			ctx->tag[i] = tagRow[i];
+			ctx->index[i] = indexRow[i];
+		}
+	} else {
 	log("get tag");
 	//initialize tags
     	for(int i = 0; i < NUM_TAGE_TABLES; i++) {	
-		tageTag[i] = getTag(PC, i, tageTagSize[i]);
+		ctx->tag[i] = getTag(PC, i, tageTagSize[i]);
     	}
     	//initialize index
 	log("get index");
 	UINT32 offset[13] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0} ;
        	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
-            	tageIndex[i] = getIndex(PC, i, tageTableSize[i], offset[i]);
+            	ctx->index[i] = getIndex(PC, i, tageTableSize[i], offset[i]);
        	}
+	}
        	log("initialize pred");
         //initialize prediction
-       	pred.pred = -1;
-       	pred.altPred = -1;
-       	pred.table = NUM_TAGE_TABLES;
-       	pred.altTable = NUM_TAGE_TABLES;
+       	ctx->pred.pred = -1;
+       	ctx->pred.altPred = -1;
+       	ctx->pred.table = NUM_TAGE_TABLES;
+       	ctx->pred.altTable = NUM_TAGE_TABLES;
       
 	log("check tags");
        	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) { //check for tag hits  
-		log("accessing index: ", tageIndex[i]);
-		log("tag: ", tageTag[i]);
+		log("accessing index: ", ctx->index[i]);
+		log("tag: ", ctx->tag[i]);
 		log("value: ", tagTables[0][0].tag);
-	        if(tagTables[i][tageIndex[i]].tag == tageTag[i]) { //tag hit
-                	pred.table = i;
-			pred.index = tageIndex[i];
+	        if(tagTables[i][ctx->index[i]].tag == ctx->tag[i]) { //tag hit
+                	ctx->pred.table = i;
+			ctx->pred.index = ctx->index[i];
                	 	break;
             	}  
        	}      
 	log("check tags for altpred");
-        for(UINT32 i = pred.table + 1; i < NUM_TAGE_TABLES; i++) { //check for tag hits on lower tables
-                if(tagTables[i][tageIndex[i]].tag == tageTag[i]) { //tag hit
-                    	pred.altTable = i;
-			pred.altIndex = tageIndex[i];
+        for(UINT32 i = ctx->pred.table + 1; i < NUM_TAGE_TABLES; i++) { //check for tag hits on lower tables
+                if(tagTables[i][ctx->index[i]].tag == ctx->tag[i]) { //tag hit
+                    	ctx->pred.altTable = i;
+			ctx->pred.altIndex = ctx->index[i];
                     	break;
                 }  
         }    
         log("make pred");
-   	if(pred.table < NUM_TAGE_TABLES) { //if we haven't missed a table        
-       		if(pred.altTable == NUM_TAGE_TABLES) { //if altPred missed a table
-           		pred.altPred = (bimodal[bimodalIndex].pred > BIMODAL_PRED_MAX/2); //use bimodal
+   	if(ctx->pred.table < NUM_TAGE_TABLES) { //if we haven't missed a table        
+       		if(ctx->pred.altTable == NUM_TAGE_TABLES) { //if altPred missed a table
+           		ctx->pred.altPred = bimodalPredict(&bimodal[bimodalIndex]); //use bimodal
        		} else{ //if altpred hit a table
-           		if(tagTables[pred.altTable][pred.altIndex].pred >= TAGE_PRED_MAX/2) //use bimodal prediction
-                		pred.altPred = TAKEN;
+           		if(tagTables[ctx->pred.altTable][ctx->pred.altIndex].pred >= TAGE_PRED_MAX/2) //use bimodal prediction
+                		ctx->pred.altPred = TAKEN;
             		else 
-                		pred.altPred = NOT_TAKEN;
+                		ctx->pred.altPred = NOT_TAKEN;
        		}
-        	if((tagTables[pred.table][pred.index].pred  != WEAKLY_NOT_TAKEN) || //if pred is not weak,
-		   (tagTables[pred.table][pred.index].pred != WEAKLY_TAKEN) ||     
-		   (tagTables[pred.table][pred.index].u != 0) ||                    //useful,
+        	if((tagTables[ctx->pred.table][ctx->pred.index].pred  != WEAKLY_NOT_TAKEN) || //if pred is not weak,
+		   (tagTables[ctx->pred.table][ctx->pred.index].pred != WEAKLY_TAKEN) ||     
+		   (tagTables[ctx->pred.table][ctx->pred.index].u != 0) ||                    //useful,
 		   (altBetterCount < ALTPRED_BET_INIT)) {                           //altpred historically not useful
-            		pred.pred = tagTables[pred.table][pred.index].pred >= TAGE_PRED_MAX/2;
-            		return pred.pred; //return best prediction
+            		ctx->pred.pred = tagTables[ctx->pred.table][ctx->pred.index].pred >= TAGE_PRED_MAX/2;
+            		ctx->predDir = ctx->pred.pred; //best prediction
+            		ctx->conf = tageConf(&tagTables[ctx->pred.table][ctx->pred.index]);
         	} else {
-            		return pred.altPred; //return alt-pred
+            		ctx->predDir = ctx->pred.altPred; //alt-pred
+            		ctx->conf = CONF_LOW; //provider too new to trust, alt-pred isn't better
         	}
     	} else { //if both missed
-        	pred.altPred =  (bimodal[bimodalIndex].pred > BIMODAL_PRED_MAX/2); //use bimodal table prediction
-        	return pred.altPred; //return alt-pred
+        	ctx->pred.altPred =  bimodalPredict(&bimodal[bimodalIndex]); //use bimodal table prediction
+        	ctx->predDir = ctx->pred.altPred;
+        	ctx->conf = bimodalConf(&bimodal[bimodalIndex]);
     	}
+	if(SC)
+		scLookup(PC, ctx);
 	log("out pred");
+	return ctx->predDir;
+}
+
+//statistical corrector: add up the weights PC and history pick from each GEHL table and the
+//bias weight for the PC and TAGE's direction, and let the sum's sign override TAGE when it
+//disagrees by at least the threshold
+void   PREDICTOR::scLookup(UINT32 PC, predToken_t *ctx) const{
+	for(int i = 0; i < NUM_SC_TABLES; i++) {
+		ctx->scIndex[i] = (i << SC_LOG_SIZE) + scHash(PC, *scGHR, SC_HIST_LENS[i]);
+	}
+	ctx->scIndex[NUM_SC_TABLES] = (NUM_SC_TABLES << SC_LOG_SIZE) + (((PC << 1) | ctx->predDir) & ((2 << SC_BIAS_LOG) - 1));
+	ctx->scSum = scSumWeights(scWeights, ctx->scIndex);
+	ctx->tagePred = ctx->predDir;
+	if((ctx->scSum >= 0) != ctx->predDir && abs(ctx->scSum) >= scThreshold) {
+		ctx->predDir = (ctx->scSum >= 0);
+		ctx->conf = CONF_LOW; //TAGE and the corrector disagree
+	}
+}
+
+//train the corrector on the last prediction's weights, the way O-GEHL does: only when its
+//sum was wrong or not past the threshold, and the threshold follows the overrides it made
+void   PREDICTOR::scTrain(bool resolveDir){
+	bool scPred = (scSum >= 0);
+	if(scPred != tagePred) { //the corrector disagreed with TAGE, so the threshold mattered
+		if(scPred != resolveDir) {
+			if(++scThresholdCtr == SC_TC_MAX) {
+				scThresholdCtr = 0;
+				if(scThreshold < (1 << SC_THRESHOLD_BITS) - 1)
+					++scThreshold;
+			}
+		} else if(abs(scSum) < scThreshold) {
+			if(--scThresholdCtr == -SC_TC_MAX - 1) {
+				scThresholdCtr = 0;
+				if(scThreshold > 0)
+					--scThreshold;
+			}
+		}
+	}
+	if(scPred != resolveDir || abs(scSum) < scThreshold) {
+		for(int i = 0; i <= NUM_SC_TABLES; i++) {
+			int8_t *w = &scWeights[scIndex[i]];
+			if(resolveDir && *w < SC_WEIGHT_MAX)
+				++(*w);
+			else if(!resolveDir && *w > -SC_WEIGHT_MAX - 1)
+				--(*w);
+		}
+	}
 }
 
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
  
 void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
+	if(numThreads > 1) {
+		++threads[thread].branches;
+		if(predDir != resolveDir)
+			++threads[thread].miss;
+	}
+	if(FRONTEND)
+		frontendBranch(PC, resolveDir, predDir, branchTarget);
+	if(OVERRIDE)
+		overrideBranch(PC, resolveDir, predDir);
+	if(!updQueue) {
+		train(PC, resolveDir, predDir, branchTarget);
+		return;
+	}
+	//train in place on top of any write still waiting for an entry, then turn each entry it
+	//changed into a queued write and put the stale value back, so lookups keep seeing the stale
+	//tables until the write lands
+	UINT32 bimodalIndex = (PC) % (numBimodalEntries);
+	UINT32 loopIndex = loopEntry(PC);
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		tagVal_t *entry = &tagTables[i][tageIndex[i]];
+		UINT32 pending = updPendingTag[i][tageIndex[i]];
+		updSavedTag[i] = *entry;
+		if(pending)
+			*entry = updQueue[pending - 1].tagVal;
+		updStartTag[i] = *entry;
+	}
+	updSavedBimodal = bimodal[bimodalIndex];
+	if(updPendingBimodal[bimodalIndex])
+		bimodal[bimodalIndex] = updQueue[updPendingBimodal[bimodalIndex] - 1].bimodVal;
+	bimodVal_t startBimodal = bimodal[bimodalIndex];
+	loopRead(loopIndex, &updSavedLoop);
+	loopVal_t startLoop = updSavedLoop;
+	if(updPendingLoop[loopIndex]) {
+		startLoop = updQueue[updPendingLoop[loopIndex] - 1].loopVal;
+		loopWrite(loopIndex, &startLoop);
+	}
+	int8_t startSC[NUM_SC_TABLES + 1];
+	if(SC) {
+		for(int i = 0; i <= NUM_SC_TABLES; i++) {
+			updSavedSC[i] = scWeights[scIndex[i]];
+			if(updPendingSC[scIndex[i]])
+				scWeights[scIndex[i]] = updQueue[updPendingSC[scIndex[i]] - 1].weight;
+			startSC[i] = scWeights[scIndex[i]];
+		}
+	}
+	train(PC, resolveDir, predDir, branchTarget);
+	++updBranches;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		tagVal_t *entry = &tagTables[i][tageIndex[i]];
+		if(entry->pred != updStartTag[i].pred || entry->tag != updStartTag[i].tag || entry->u != updStartTag[i].u)
+			delayWrite(&updPendingTag[i][tageIndex[i]], i, tageIndex[i])->tagVal = *entry;
+		*entry = updSavedTag[i];
+	}
+	if(bimodal[bimodalIndex].pred != startBimodal.pred)
+		delayWrite(&updPendingBimodal[bimodalIndex], NUM_TAGE_TABLES, bimodalIndex)->bimodVal = bimodal[bimodalIndex];
+	bimodal[bimodalIndex] = updSavedBimodal;
+	if(OVERRIDE) { //overrideBranch left the fast table to the queue, it trains on every branch
+		UINT32 *pending = &updPendingFast[bimodalIndex];
+		bimodVal_t fast = *pending ? updQueue[*pending - 1].bimodVal : fastTable[bimodalIndex];
+		UINT32 fastStart = fast.pred;
+		bimodalTrain(&fast, resolveDir);
+		if(fast.pred != fastStart)
+			delayWrite(pending, NUM_TAGE_TABLES + 3, bimodalIndex)->bimodVal = fast;
+	}
+	loopVal_t loopVal;
+	loopVal_t *loop = &loopVal;
+	loopRead(loopIndex, loop);
+	if(loop->loopCount != startLoop.loopCount || loop->currentIter != startLoop.currentIter ||
+	   loop->tag != startLoop.tag || loop->conf != startLoop.conf || loop->age != startLoop.age ||
+	   loop->pred != startLoop.pred || loop->used != startLoop.used)
+		delayWrite(&updPendingLoop[loopIndex], NUM_TAGE_TABLES + 1, loopIndex)->loopVal = *loop;
+	loopWrite(loopIndex, &updSavedLoop);
+	if(SC) {
+		for(int i = 0; i <= NUM_SC_TABLES; i++) {
+			int8_t *w = &scWeights[scIndex[i]];
+			if(*w != startSC[i])
+				delayWrite(&updPendingSC[scIndex[i]], NUM_TAGE_TABLES + 2, scIndex[i])->weight = *w;
+			*w = updSavedSC[i];
+		}
+	}
+}
+
+//index of PC's loop entry. Direct-mapped that's just its slot. In a set it's the way holding PC's
+//tag, else the way with the lowest age, which a miss ages and replaces once it gets to 0. The
+//set is one cache line.
+UINT32 PREDICTOR::loopEntry(UINT32 PC) const{
+	if(LOOP_WAYS == 1)
+		return (PC) % (loopTableSize);
+	const UINT64 *set = &loopPacked[(PC) % (loopSets) * LOOP_WAYS];
+	UINT64 loopTag = (PC) % (1<<LOOP_TAG_SIZE);
+	//one pass over the line without branches: a mask of tag hits, and the lowest age with its way
+	//in the low 3 bits
+	UINT32 hits = 0;
+	UINT32 oldest = ~0u;
+	for(UINT32 w = 0; w < LOOP_WAYS; w++) {
+		UINT64 word = set[w];
+		hits |= (UINT32)((word & ((1<<LOOP_TAG_SIZE) - 1)) == loopTag) << w;
+		UINT32 key = ((UINT32)(word >> LOOP_AGE_SHIFT) & ((1<<LOOP_AGE_BITS) - 1)) << 3 | w;
+		oldest = (key < oldest) ? key : oldest;
+	}
+	return (set - loopPacked) + (hits ? __builtin_ctz(hits) : (oldest & 7));
+}
+
+//copy a loop entry out of and back into whichever table LOOP_WAYS picked
+void PREDICTOR::loopRead(UINT32 index, loopVal_t *entry) const{
+	if(LOOP_WAYS == 1)
+		*entry = loopTable[index];
+	else
+		loopUnpack(loopPacked[index], entry);
+}
+
+void PREDICTOR::loopWrite(UINT32 index, const loopVal_t *entry){
+	if(LOOP_WAYS == 1)
+		loopTable[index] = *entry;
+	else
+		loopPacked[index] = loopPack(entry);
+}
+
+//UpdatePredictor proper, writing straight into the tables
+void  PREDICTOR::train(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
 	log("in update");
    	bool newInTable;    
+	//take an occupancy snapshot every SNAPSHOT_INTERVAL branches
+	if(SNAPSHOT && ++snapBranches == SNAPSHOT_INTERVAL) {
+		snapBranches = 0;
+		snapshot();
+	}
+	if(ALIAS && ++aliasBranches == ALIAS_INTERVAL) {
+		aliasBranches = 0;
+		aliasReport();
+	}
+	if(CONF_STATS) {
+		++(confBranches[conf]);
+		if(predDir != resolveDir)
+			++(confMiss[conf]);
+		if(++confCount == CONF_INTERVAL) {
+			confCount = 0;
+			confReport();
+		}
+	}
 	UINT32 bimodalIndex = (PC) % (numBimodalEntries); //get bimodal index
 
-	UINT32 loopIndex = (PC) % (loopTableSize);
-	UINT32 loopTag = (PC) & (1<<LOOP_TAG_SIZE);
+	UINT32 loopIndex = loopEntry(PC);
+	if(SC) //the corrector's history moves on with every update, rows and batches included
+		*scGHR = (*scGHR << 1) | resolveDir;
 	//update loop perdictor
-	if(loopTable[loopIndex].tag != loopTag && loopTable[loopIndex].age > 0){ //if tag miss
-		--(loopTable[loopIndex].age); //decrease age
-	} else { //if tag hit:
-		if(loopTable[loopIndex].age == 0){ //if entry is old or blank
-			//initialize a new entry
-			loopTable[loopIndex].tag = (PC) % (1<<LOOP_TAG_SIZE);
-			loopTable[loopIndex].age = (1<<LOOP_AGE_MAX) + 1;
-			loopTable[loopIndex].currentIter = 1;
-			loopTable[loopIndex].loopCount = (1<<LOOP_IT_MAX); 
-			loopTable[loopIndex].conf = 0;
-			loopTable[loopIndex].pred = 0;
-		} else {
-			if(loopTable[loopIndex].pred == resolveDir) { //prediction was correct
-				if(loopTable[loopIndex].currentIter != loopTable[loopIndex].loopCount){
-					++(loopTable[loopIndex].currentIter);
-				} else if(loopTable[loopIndex].currentIter == loopTable[loopIndex].loopCount){
-					loopTable[loopIndex].currentIter = 0;
-					if(loopTable[loopIndex].conf < LOOP_CONF_MAX)
-						++(loopTable[loopIndex].conf);
-				}
-			} else { //prediction was incorrect
-				if(loopTable[loopIndex].age == (1<<LOOP_AGE_MAX)) { 
-					loopTable[loopIndex].loopCount = loopTable[loopIndex].currentIter;
-					loopTable[loopIndex].currentIter = 0;
-					loopTable[loopIndex].conf = 1;
-				} else {
-					loopTable[loopIndex].loopCount = 0;
-					loopTable[loopIndex].currentIter = 0;
-					loopTable[loopIndex].tag = 0;
-					loopTable[loopIndex].conf = 0;
-					loopTable[loopIndex].age = 0;
-					loopTable[loopIndex].pred = false;
-				}
-			}
-		}
-		if(loopTable[loopIndex].used){
-			return;
-		}
+	loopVal_t loopVal;
+	loopRead(loopIndex, &loopVal);
+	bool loopProvided = loopTrain(&loopVal, PC, resolveDir, loopPred, loopUsed);
+	loopWrite(loopIndex, &loopVal);
+	if(loopProvided) { //loop predictor provided this one
+		updateHistory(PC, resolveDir, predDir); //tables are left alone, but history always moves on
+		return;
 	}
 	log("after loop:");
+	//TAGE allocates and ages on its own prediction, the corrector may have replaced it
+	bool tageDir = (SC && !loopUsed) ? tagePred : predDir;
+	if(SC)
+		scTrain(resolveDir);
 	//update prediction counters in tag/bimodal tables
 	int predictionVal = -1;
     	int altPredVal = -1;
 	if(pred.table < NUM_TAGE_TABLES) { // update prediction counters
 		log("pred.table: ", pred.table);
+		if(SNAPSHOT)
+			++(snapHits[pred.table]);
+		if(ALIAS) { //was the tag hit really this branch and history?
+			aliasVal_t *shadow = &aliasTables[pred.table][pred.index];
+			++(aliasStats[pred.table].hits);
+			if(!shadow->valid)
+				++(aliasStats[pred.table].cold);
+			else if(shadow->PC != PC)
+				++(aliasStats[pred.table].falsePC);
+			else if(shadow->hist != aliasHist[pred.table])
+				++(aliasStats[pred.table].falseCtx);
+		}
 		predictionVal = tagTables[pred.table][pred.index].pred; 
         	if(resolveDir && predictionVal < TAGE_PRED_MAX) {   //if TAKEN and pred<max
 			++(tagTables[pred.table][pred.index].pred); //increment
@@ -391,12 +1167,7 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
 		} 
     	} else { //do the same for bimodal
 		log("in bimod table inc");
-		predictionVal = bimodal[bimodalIndex].pred;
-                if(resolveDir && predictionVal < BIMODAL_PRED_MAX) {
-            		++(bimodal[bimodalIndex].pred);
-        	} else if(!resolveDir && predictionVal > 0) {
-            		--(bimodal[bimodalIndex].pred);
-        	}
+		bimodalTrain(&bimodal[bimodalIndex], resolveDir);
     	}
 	log("after update ctr");
     	//check age of current tag entry, given we hit an entry
@@ -419,7 +1190,7 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
 	log("after update new");
 	//steal entry
     	//if((!newInTable) || (newInTable && (pred.pred != resolveDir))) { //if table's not new, or pred is wrong
-		if (((predDir != resolveDir) & (pred.table > 0))) { //if pred is wrong and there was a tag miss     
+		if (((tageDir != resolveDir) & (pred.table > 0))) { //if pred is wrong and there was a tag miss     
 	    		bool alloc = false;
 			for (int i = 0; i < pred.table; i++) {
 				if (tagTables[i][tageIndex[i]].u == 0) //if one isn't useful
@@ -431,7 +1202,7 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
                 		}
             		} else { //else
 				for(int i = pred.table-1; i>=0; i--){
-					if((tagTables[i][tageIndex[i]].u == 0 && !(rand()%10))) {
+					if((tagTables[i][tageIndex[i]].u == 0 && !nextTenth())) {
 						if(resolveDir) { //if TAKEN
                                                         tagTables[i][tageIndex[i]].pred = WEAKLY_TAKEN; 
                                                 } else  { //if NOT TAKEN
@@ -439,6 +1210,13 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
                                                 }    
                                                 tagTables[i][tageIndex[i]].tag = tageTag[i]; //reset tag
                                                 tagTables[i][tageIndex[i]].u = 0;            //set to useless
+						if(SNAPSHOT)
+							++(snapAllocs[i]);
+						if(ALIAS) {
+							aliasTables[i][tageIndex[i]].PC = PC;
+							aliasTables[i][tageIndex[i]].hist = aliasHist[i];
+							aliasTables[i][tageIndex[i]].valid = true;
+						}
                                                 break; 
 
 					}
@@ -449,10 +1227,10 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
 	log("after steal");
 	// update usefuness bit (no meta-pred)
 	if(pred.table < NUM_TAGE_TABLES) {
-        	if ((predDir != pred.altPred)) { //if altpred wasn't used
-	    		if (predDir == resolveDir && tagTables[pred.table][pred.index].u < PRED_U_MAX )  //if prediction was correct
+        	if ((tageDir != pred.altPred)) { //if altpred wasn't used
+	    		if (tageDir == resolveDir && tagTables[pred.table][pred.index].u < PRED_U_MAX )  //if prediction was correct
 				++(tagTables[pred.table][pred.index].u); //set useful
-			else if(predDir != resolveDir && tagTables[pred.table][pred.index].u > 0)
+			else if(tageDir != resolveDir && tagTables[pred.table][pred.index].u > 0)
 				--(tagTables[pred.table][pred.index].u); //set not useful
 		}  
 	}
@@ -473,13 +1251,56 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
 								     //else reset upper bit
 			}
 		}
+		if(updQueue) { //queued writes and the entries being trained age with the tables
+			for(UINT32 q = 0; q < updCount; q++) {
+				pendingWrite_t *w = &updQueue[(updHead + q) % updQueueSize];
+				if(w->table >= 0 && w->table < NUM_TAGE_TABLES)
+					w->tagVal.u &= (clockState+1);
+			}
+			for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+				updSavedTag[i].u &= (clockState+1);
+				updStartTag[i].u &= (clockState+1);
+			}
+		}
 	}
 	log("after clock");
- 	//update the GHR
-  	*GHR = (*GHR << 1);
-  	if(resolveDir == TAKEN){
-    		GHR->set(0,1); 
-  	}	
+	updateHistory(PC, resolveDir, predDir);
+	log("out pred");
+}
+
+//shift the branch into the GHR, CSRs and PHR, or just step to the next row if they were
+//precomputed (ALIAS needs the live GHR, so it only counts history when hashing live)
+void PREDICTOR::updateHistory(UINT32 PC, bool resolveDir, bool predDir){
+	if(rowIndex) {
+		++rowPos;
+		return;
+	}
+	if(SPEC_HISTORY) { //already holds predDir, on a mispredict roll back and take the real direction
+		if(predDir != resolveDir) {
+			histCkpt_t *c = &ckpts[ckpt];
+			for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+				csrIndex[i].val = c->csrIndex[i];
+				csrTag[0][i].val = c->csrTag[0][i];
+				csrTag[1][i].val = c->csrTag[1][i];
+			}
+			*PHR = c->PHR;
+			specHead = c->histHead;
+			ckptNext = (ckpt + 1) % SPEC_MAX_INFLIGHT; //younger branches in flight are squashed
+			specPush(PC, resolveDir);
+		}
+		return;
+	}
+	if(numThreads > 1) { //the shared GHR belongs to no thread, each folds from its own ring
+		threadPush(PC, resolveDir);
+		return;
+	}
+ 	//update the GHR, unless its owner already did
+	if(!historyShared) {
+  		*GHR = (*GHR << 1);
+  		if(resolveDir == TAKEN){
+    			GHR->set(0,1); 
+  		}
+	}
 	log("set GHR");
 
 	
@@ -488,31 +1309,332 @@ void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT3
             fold(&csrIndex[i]);
             fold(&csrTag[0][i]);
             fold(&csrTag[1][i]);
+            if(ALIAS)
+                aliasFold(&aliasHist[i], tageHistory[i]);
     	}
 	log("folded");
   	
 	//update path history
-    	PHR = (PHR << 1);
-    	if(PC & 1) {
-       		PHR = PHR + 1;
-    	}
-    	PHR = (PHR & ((1 << PHR_LEN) - 1));
-	log("out pred");
+    	*PHR = pathHistory(*PHR, PC);
+}
+
+//hold table writes back for delay branches (0 writes in place again). Anything still queued
+//lands first.
+void PREDICTOR::setUpdateDelay(UINT32 delay){
+	delayApply(~(UINT64)0);
+	delete[] updQueue;
+	updQueue = NULL;
+	updDelay = delay;
+	if(delay == 0)
+		return;
+	if(!updSavedTag) {
+		updPendingTag = new UINT32*[NUM_TAGE_TABLES];
+		for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+			UINT32 tableSize = (1<<tageTableSize[i]);
+			updPendingTag[i] = new UINT32[tableSize];
+			for(UINT32 j = 0; j < tableSize; j++) {
+				updPendingTag[i][j] = 0;
+			}
+		}
+		updPendingBimodal = new UINT32[numBimodalEntries];
+		for(UINT32 i = 0; i < numBimodalEntries; i++) {
+			updPendingBimodal[i] = 0;
+		}
+		updPendingLoop = new UINT32[loopTableSize];
+		for(UINT32 i = 0; i < loopTableSize; i++) {
+			updPendingLoop[i] = 0;
+		}
+		if(SC) {
+			updPendingSC = new UINT32[SC_WEIGHTS];
+			for(UINT32 i = 0; i < SC_WEIGHTS; i++) {
+				updPendingSC[i] = 0;
+			}
+		}
+		if(OVERRIDE) {
+			updPendingFast = new UINT32[numBimodalEntries];
+			for(UINT32 i = 0; i < numBimodalEntries; i++) {
+				updPendingFast[i] = 0;
+			}
+		}
+		updSavedTag = new tagVal_t[NUM_TAGE_TABLES];
+		updStartTag = new tagVal_t[NUM_TAGE_TABLES];
+	}
+	//every update queues at most one write per table (a superseded one keeps its slot until it's
+	//due), and writes wait at most delay+1 updates
+	updQueueSize = (delay + 2) * (NUM_TAGE_TABLES + 2 + (SC ? NUM_SC_TABLES + 1 : 0) + (OVERRIDE ? 1 : 0));
+	updQueue = new pendingWrite_t[updQueueSize];
+	updHead = 0;
+	updCount = 0;
+}
+
+//land every queued write due by update upTo, oldest first
+void PREDICTOR::delayApply(UINT64 upTo){
+	while(updCount && updQueue[updHead].due <= upTo) {
+		pendingWrite_t *w = &updQueue[updHead];
+		if(w->table < 0) {
+			//superseded by a later write to the same entry, which holds its value
+		} else if(w->table < NUM_TAGE_TABLES) {
+			tagTables[w->table][w->index] = w->tagVal;
+			updPendingTag[w->table][w->index] = 0;
+		} else if(w->table == NUM_TAGE_TABLES) {
+			bimodal[w->index] = w->bimodVal;
+			updPendingBimodal[w->index] = 0;
+		} else if(w->table == NUM_TAGE_TABLES + 1) {
+			loopWrite(w->index, &w->loopVal);
+			updPendingLoop[w->index] = 0;
+		} else if(w->table == NUM_TAGE_TABLES + 2) {
+			scWeights[w->index] = w->weight;
+			updPendingSC[w->index] = 0;
+		} else {
+			fastTable[w->index] = w->bimodVal;
+			updPendingFast[w->index] = 0;
+		}
+		updHead = (updHead + 1) % updQueueSize;
+		--updCount;
+	}
+}
+
+//queue slot for a write to entry index of table, landing updDelay updates from now. A write
+//still waiting for the entry is dropped, the new value was trained on top of it.
+pendingWrite_t *PREDICTOR::delayWrite(UINT32 *pending, int table, UINT32 index){
+	if(*pending)
+		updQueue[*pending - 1].table = -1;
+	if(updCount == updQueueSize) //full, land the oldest early
+		delayApply(updQueue[updHead].due);
+	UINT32 slot = (updHead + updCount) % updQueueSize;
+	++updCount;
+	*pending = slot + 1;
+	pendingWrite_t *w = &updQueue[slot];
+	w->table = table;
+	w->index = index;
+	w->due = updBranches + updDelay;
+	return w;
+}
+
+//speculative counterpart of the GHR shift and folding, on the history ring
+void PREDICTOR::specPush(UINT32 PC, bool dir){
+	specHead = (specHead + 1) % SPEC_HIST_SIZE;
+	specHist[specHead] = dir;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		bool oldest = specHist[(specHead + SPEC_HIST_SIZE - tageHistory[i]) % SPEC_HIST_SIZE];
+		foldBits(&csrIndex[i], dir, oldest);
+		foldBits(&csrTag[0][i], dir, oldest);
+		foldBits(&csrTag[1][i], dir, oldest);
+	}
+	*PHR = pathHistory(*PHR, PC);
+}
+
+//share the tables between count hardware threads, each with its own GHR ring, CSRs, PHR and
+//corrector history, all starting empty. Call before the first branch. Thread 0 keeps the
+//history the predictor was built with. Not for SPEC_HISTORY, ALIAS or index streams, which
+//only follow one history.
+void PREDICTOR::setThreads(UINT32 count){
+	if(count == 0)
+		count = 1;
+	threadCtx_t *grown = new threadCtx_t[count];
+	for(UINT32 t = 0; t < count; t++) {
+		threadCtx_t *ctx = &grown[t];
+		if(t < numThreads) {
+			*ctx = threads[t];
+		} else {
+			ctx->csrIndex = new csr_t[NUM_TAGE_TABLES];
+			ctx->csrTag[0] = new csr_t[NUM_TAGE_TABLES];
+			ctx->csrTag[1] = new csr_t[NUM_TAGE_TABLES];
+			for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+				initFold(&ctx->csrIndex[i], tageHistory[i], tageTagSize[i]);
+				initFold(&ctx->csrTag[0][i], tageHistory[i], tageTagSize[i]);
+				initFold(&ctx->csrTag[1][i], tageHistory[i], tageTagSize[i]-1);
+			}
+			ctx->hist = NULL;
+			ctx->PHR = 0;
+			ctx->scGHR = 0;
+			ctx->insts = 0;
+			ctx->branches = 0;
+			ctx->miss = 0;
+		}
+		if(!ctx->hist && count > 1) { //thread 0's history so far is empty too
+			ctx->hist = new bool[SMT_HIST_SIZE];
+			for(UINT32 i = 0; i < SMT_HIST_SIZE; i++) {
+				ctx->hist[i] = false;
+			}
+			ctx->head = 0;
+		}
+	}
+	delete[] threads;
+	threads = grown;
+	numThreads = count;
+	setThread(thread < count ? thread : 0);
+}
+
+//run the calls that follow on thread tid's history. Only pointers move, nothing is copied.
+void PREDICTOR::setThread(UINT32 tid){
+	threadCtx_t *ctx = &threads[tid];
+	thread = tid;
+	csrIndex = ctx->csrIndex;
+	csrTag[0] = ctx->csrTag[0];
+	csrTag[1] = ctx->csrTag[1];
+	PHR = &ctx->PHR;
+	scGHR = &ctx->scGHR;
+}
+
+//the running thread's GHR shift and folding, on its history ring
+void PREDICTOR::threadPush(UINT32 PC, bool dir){
+	threadCtx_t *ctx = &threads[thread];
+	ctx->head = (ctx->head + 1) % SMT_HIST_SIZE;
+	ctx->hist[ctx->head] = dir;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		bool oldest = ctx->hist[(ctx->head + SMT_HIST_SIZE - tageHistory[i]) % SMT_HIST_SIZE];
+		foldBits(&csrIndex[i], dir, oldest);
+		foldBits(&csrTag[0][i], dir, oldest);
+		foldBits(&csrTag[1][i], dir, oldest);
+	}
+	*PHR = pathHistory(*PHR, PC);
+}
+
+//write each thread's instructions, branches, mispredictions and MPKI to smt.txt, then the
+//whole core's
+void PREDICTOR::threadReport(){
+	std::ofstream out("smt.txt", std::ios_base::app);
+	UINT64 insts = 0, branches = 0, miss = 0;
+	for(UINT32 t = 0; t < numThreads; t++) {
+		const threadCtx_t *ctx = &threads[t];
+		out<<"thread "<<t<<" instructions "<<ctx->insts<<" branches "<<ctx->branches<<" miss "<<ctx->miss;
+		out<<" mpki "<<(ctx->insts ? 1000.0 * ctx->miss / ctx->insts : 0.0)<<std::endl;
+		insts += ctx->insts;
+		branches += ctx->branches;
+		miss += ctx->miss;
+	}
+	out<<"total instructions "<<insts<<" branches "<<branches<<" miss "<<miss;
+	out<<" mpki "<<(insts ? 1000.0 * miss / insts : 0.0)<<std::endl<<std::endl;
+}
+
+//run the tables over a stream built from the trace about to be predicted. Call before the
+//first branch, the stream starts from empty history.
+void PREDICTOR::useStream(const INDEX_STREAM *stream){
+	rowIndex = stream ? stream->indexRow(0) : NULL;
+	rowTag = stream ? stream->tagRow(0) : NULL;
+	rowCount = stream ? stream->size() : 0;
+	rowPos = 0;
+}
+
+//predict and update n resolved branches in one call, preds[k] gets the prediction for
+//records[k] exactly as GetPrediction would have made it. The history only depends on the
+//records, so every branch of the batch is hashed first, then the tables run over the rows.
+void PREDICTOR::predictBatch(const branchRecord_t *records, UINT32 n, bool *preds){
+	if(!rowIndex && !ALIAS && !SPEC_HISTORY) {
+		if(n > batchSize) {
+			delete[] batchIndex;
+			delete[] batchTag;
+			batchIndex = new UINT32[n * NUM_TAGE_TABLES];
+			batchTag = new UINT16[n * NUM_TAGE_TABLES];
+			batchSize = n;
+		}
+		for(UINT32 k = 0; k < n; k++) {
+			UINT32 *indexOut = &batchIndex[k * NUM_TAGE_TABLES];
+			UINT16 *tagOut = &batchTag[k * NUM_TAGE_TABLES];
+			for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+				tagOut[i] = hashTag(records[k].PC, csrTag[0][i].val, csrTag[1][i].val, tageTagSize[i]);
+				indexOut[i] = hashIndex(records[k].PC, csrIndex[i].val, *PHR, tageTableSize[i], 0);
+			}
+			updateHistory(records[k].PC, records[k].resolveDir, records[k].resolveDir);
+		}
+		rowIndex = batchIndex;
+		rowTag = batchTag;
+		rowCount = n;
+		rowPos = 0;
+		for(UINT32 k = 0; k < n; k++) {
+			preds[k] = PREDICTOR::GetPrediction(records[k].PC);
+			PREDICTOR::UpdatePredictor(records[k].PC, records[k].resolveDir, preds[k], records[k].branchTarget);
+		}
+		rowIndex = NULL;
+		rowTag = NULL;
+		rowCount = 0;
+		rowPos = 0;
+	} else { //already on a stream's rows, or ALIAS or SPEC_HISTORY need the history per branch
+		for(UINT32 k = 0; k < n; k++) {
+			preds[k] = PREDICTOR::GetPrediction(records[k].PC);
+			PREDICTOR::UpdatePredictor(records[k].PC, records[k].resolveDir, preds[k], records[k].branchTarget);
+		}
+	}
+}
+
+//GetPrediction that hands its lookup state back in token instead of keeping it for the next
+//UpdatePredictor, so a pipeline model can have several branches outstanding and update them
+//later, in order. History only moves on update unless SPEC_HISTORY is set, in which case a
+//mispredicted update squashes the younger tokens and those branches must be predicted again.
+//Tokens always hash live (a stream or batch's rows assume one branch in flight).
+bool PREDICTOR::predict(UINT32 PC, predToken_t *token){
+	token->predDir = PREDICTOR::GetPrediction(PC);
+	token->pred = pred;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		token->index[i] = tageIndex[i];
+		token->tag[i] = tageTag[i];
+	}
+	token->loopPred = loopPred;
+	token->loopUsed = loopUsed;
+	token->conf = conf;
+	token->fastPred = fastPred;
+	for(int i = 0; i <= NUM_SC_TABLES; i++) {
+		token->scIndex[i] = scIndex[i];
+	}
+	token->scSum = scSum;
+	token->tagePred = tagePred;
+	token->ckpt = ckpt;
+	return token->predDir;
+}
+
+//UpdatePredictor for the branch token came from, with the lookup state it was predicted with
+void PREDICTOR::update(UINT32 PC, bool resolveDir, const predToken_t *token, UINT32 branchTarget){
+	pred = token->pred;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		tageIndex[i] = token->index[i];
+		tageTag[i] = token->tag[i];
+	}
+	loopPred = token->loopPred;
+	loopUsed = token->loopUsed;
+	conf = token->conf;
+	fastPred = token->fastPred;
+	for(int i = 0; i <= NUM_SC_TABLES; i++) {
+		scIndex[i] = token->scIndex[i];
+	}
+	scSum = token->scSum;
+	tagePred = token->tagePred;
+	ckpt = token->ckpt;
+	PREDICTOR::UpdatePredictor(PC, resolveDir, token->predDir, branchTarget);
+}
+
+//prefetch the tagged rows of the branch distance ahead while running a stream, 0 for none
+void PREDICTOR::setPrefetch(UINT32 distance){
+	prefetchDist = distance;
+}
+
+//start fetching what GetPrediction(PC) will read next: the bimodal and loop entries, and
+//the tagged rows too if they're known from a stream or batch
+void PREDICTOR::prefetchBranch(UINT32 PC){
+	PREFETCH(&bimodal[(PC) % (numBimodalEntries)]);
+	if(LOOP_WAYS == 1)
+		PREFETCH(&loopTable[(PC) % (loopTableSize)]);
+	else
+		PREFETCH(&loopPacked[(PC) % (loopSets) * LOOP_WAYS]);
+	if(rowIndex && rowPos < rowCount) {
+		const UINT32 *row = &rowIndex[rowPos * NUM_TAGE_TABLES];
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			PREFETCH(&tagTables[i][row[i]]);
+		}
+	}
 }
 
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 
 //hash function for the new tag for the ppm table
-UINT32 PREDICTOR::getTag(UINT32 PC, int table, UINT32 tagSize) {
-        UINT32 tag = (PC ^ csrTag[0][table].val ^ (csrTag[1][table].val << 1));
-        return (tag & ((1 << tagSize) -1));
+UINT32 PREDICTOR::getTag(UINT32 PC, int table, UINT32 tagSize) const {
+        return hashTag(PC, csrTag[0][table].val, csrTag[1][table].val, tagSize);
 }
 
 //hash function for the index to the ppm table
-UINT32 PREDICTOR::getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset) {
-	UINT32 index = PC ^ (PC >> tagSize) ^ csrIndex[table].val ^ PHR ^ (PHR & ((1<<phrOffset)-1));
-	return (index & ((1 << tagSize)-1));
+UINT32 PREDICTOR::getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset) const {
+	return hashIndex(PC, csrIndex[table].val, *PHR, tagSize, phrOffset);
 }
 
 void PREDICTOR::initFold(csr *shift, UINT32 origLen, UINT32 newLen){
@@ -523,17 +1645,169 @@ void PREDICTOR::initFold(csr *shift, UINT32 origLen, UINT32 newLen){
 
 void PREDICTOR::fold(csr_t *shift){
 	log("in fold");
-        shift->val = (shift->val << 1) + (*GHR)[0];
-	log("fold 1");
-        shift->val ^= ((shift->val & (1 << shift->newLen)) >> shift->newLen);
-        log("fold 2 ", GHR->size());
-	log("fold 2 ", shift->origLen); 
-	shift->val ^= ((*GHR)[shift->origLen] << (shift->origLen % shift->newLen));
-        log("fold 3");
-	shift->val &= ((1 << shift->newLen) -1);
+	foldHistory(shift, *GHR);
 	log("fold 4");
 }
 
+//rand() % 10 from the predictor's own lcg, so instances run side by side never take
+//allocation draws from each other
+UINT32 PREDICTOR::nextTenth(){
+	allocSeed = allocSeed * 1103515245 + 12345;
+	return (allocSeed >> 16) % 10;
+}
+
+//summarize table state into snapshot.txt from a sampled walk of each table
+void PREDICTOR::snapshot(){
+	std::ofstream out;
+	out.open("snapshot.txt", std::ios::app);
+	out<<"snapshot "<<snapCount++<<" altBetterCount "<<altBetterCount<<std::endl;
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+		UINT32 tableSize = (1<<tageTableSize[i]);
+		UINT32 samples = (tableSize < SNAPSHOT_SAMPLES) ? tableSize : SNAPSHOT_SAMPLES;
+		UINT32 stride = tableSize / samples;
+		UINT32 uHist[PRED_U_MAX + 1] = {0};
+		UINT32 predHist[TAGE_PRED_MAX + 1] = {0};
+		UINT32 occupied = 0;
+		snapSeed = snapSeed * 1103515245 + 12345; //own lcg, allocation's draws are left alone
+		UINT32 j = (snapSeed >> 16) % stride;     //random start, then fixed stride
+		for(UINT32 k = 0; k < samples; k++, j += stride) {
+			++(uHist[tagTables[i][j].u]);
+			++(predHist[tagTables[i][j].pred]);
+			if(tagTables[i][j].tag != 0)
+				++occupied;
+		}
+		out<<"table "<<i<<" occupied "<<(double)occupied/samples<<" u";
+		for(UINT32 k = 0; k <= PRED_U_MAX; k++)
+			out<<" "<<(double)uHist[k]/samples;
+		out<<" ctr";
+		for(UINT32 k = 0; k <= TAGE_PRED_MAX; k++)
+			out<<" "<<(double)predHist[k]/samples;
+		//provider hits per allocation: how often a newly placed tag gets reused
+		out<<" hits "<<snapHits[i]<<" allocs "<<snapAllocs[i]<<" reuse ";
+		out<<(snapAllocs[i] ? (double)snapHits[i]/snapAllocs[i] : 0.0)<<std::endl;
+		snapHits[i] = 0;
+		snapAllocs[i] = 0;
+	}
+	//loop table: confidence and log2 age buckets
+	UINT32 samples = (loopTableSize < SNAPSHOT_SAMPLES) ? loopTableSize : SNAPSHOT_SAMPLES;
+	UINT32 stride = loopTableSize / samples;
+	UINT32 confHist[LOOP_CONF_MAX + 1] = {0};
+	UINT32 ageHist[LOOP_AGE_MAX + 2] = {0};
+	snapSeed = snapSeed * 1103515245 + 12345;
+	UINT32 j = (snapSeed >> 16) % stride;
+	for(UINT32 k = 0; k < samples; k++, j += stride) {
+		loopVal_t loopVal;
+		loopRead(j, &loopVal);
+		++(confHist[loopVal.conf]);
+		UINT32 bucket = 0; //0 if empty, else floor(log2(age)) + 1
+		for(UINT32 age = loopVal.age; age > 0; age >>= 1)
+			++bucket;
+		++(ageHist[bucket > LOOP_AGE_MAX + 1 ? LOOP_AGE_MAX + 1 : bucket]);
+	}
+	out<<"loop conf";
+	for(UINT32 k = 0; k <= LOOP_CONF_MAX; k++)
+		out<<" "<<(double)confHist[k]/samples;
+	out<<" age";
+	for(UINT32 k = 0; k <= LOOP_AGE_MAX + 1; k++)
+		out<<" "<<(double)ageHist[k]/samples;
+	out<<std::endl;
+}
+
+//print the modelled bits of each component next to the host bytes it takes
+void PREDICTOR::reportStorage(){
+	UINT64 tageBytes = NUM_TAGE_TABLES * sizeof(tagVal_t *);
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++)
+		tageBytes += (1<<tageTableSize[i]) * sizeof(tagVal_t);
+	UINT64 bimodalBytes = numBimodalEntries * sizeof(bimodVal_t);
+	UINT64 loopBytes = (LOOP_WAYS == 1) ? loopTableSize * sizeof(loopVal_t) : loopTableSize * sizeof(UINT64) + 63;
+	UINT64 historyBytes = (historyShared ? 0 : sizeof(*GHR)) + 3 * NUM_TAGE_TABLES * sizeof(csr_t) + 2 * sizeof(csr_t *);
+	UINT64 scBytes = SC ? (SC_WEIGHTS + 4) * sizeof(int8_t) : 0;
+	//everything else: the object itself and the per-table config, index and tag arrays
+	UINT64 otherBytes = sizeof(*this) + 7 * NUM_TAGE_TABLES * sizeof(UINT32);
+	printStorage("bimodal", BIMODAL_BITS, bimodalBytes);
+	printStorage("tage", TAGE_BITS, tageBytes);
+	printStorage("loop", LOOP_BITS, loopBytes);
+	printStorage("history", HISTORY_BITS, historyBytes);
+	if(SC)
+		printStorage("sc", SC_BITS, scBytes);
+	printStorage("other", 0, otherBytes);
+	printStorage("total", TOTAL_BITS, bimodalBytes + tageBytes + loopBytes + historyBytes + scBytes + otherBytes);
+	printf("budget   modelled %8u bits = %7.2f KB\n", STORAGE_BUDGET, STORAGE_BUDGET / 8192.0);
+	if(ITTAGE) { //counted against its own budget, not in the total above
+		UINT64 itBytes = NUM_IT_TABLES * ((1 << IT_TABLE_LOG) * sizeof(targetVal_t) + sizeof(targetVal_t *)) +
+		                 (1 << IT_BASE_LOG) * sizeof(targetVal_t) + (1 << IT_REGION_LOG) * sizeof(UINT32);
+		printStorage("ittage", IT_BITS, itBytes);
+		printf("budget   modelled %8u bits = %7.2f KB (ittage)\n", IT_STORAGE_BUDGET, IT_STORAGE_BUDGET / 8192.0);
+	}
+	if(OVERRIDE) //the fast table isn't budgeted either, it models a separate first stage
+		printStorage("fast", BIMODAL_BITS, numBimodalEntries * sizeof(bimodVal_t));
+	if(FRONTEND) { //frontend structures aren't budgeted
+		printStorage("btb", BTB_BITS, 3 * (1 << BTB_SETS_LOG) * BTB_WAYS * sizeof(UINT32));
+		printStorage("ras", RAS_BITS, RAS_DEPTH * sizeof(UINT32));
+	}
+}
+
+//fold the last histLen GHR bits into 64 bits, the same way fold does into a tag
+void PREDICTOR::aliasFold(UINT64 *hist, UINT32 histLen){
+	*hist = (*hist << 1) | (*hist >> 63);                   //rotate in place of the shift
+	*hist ^= (UINT64)(*GHR)[0];                             //newest bit in
+	*hist ^= (UINT64)(*GHR)[histLen] << (histLen % 64);     //oldest bit out
+}
+
+//confidence class of the last GetPrediction: CONF_HIGH, CONF_MEDIUM or CONF_LOW
+int PREDICTOR::confidence() const {
+	return conf;
+}
+
+//write cumulative share of branches and misprediction rate per confidence class into confidence.txt
+void PREDICTOR::confReport(){
+	const char *names[NUM_CONF_CLASSES] = {"high", "medium", "low"};
+	UINT64 total = 0;
+	for(int i = 0; i < NUM_CONF_CLASSES; i++) {
+		total += confBranches[i];
+	}
+	std::ofstream out;
+	out.open("confidence.txt", std::ios::app);
+	out<<"class branches share miss missRate"<<std::endl;
+	for(int i = 0; i < NUM_CONF_CLASSES; i++) {
+		out<<names[i]<<" "<<confBranches[i]<<" "<<(total ? (double)confBranches[i]/total : 0.0)<<" ";
+		out<<confMiss[i]<<" "<<(confBranches[i] ? (double)confMiss[i]/confBranches[i] : 0.0)<<std::endl;
+	}
+	out<<std::endl;
+}
+
+//write cumulative tag hit outcomes per table and per tag size into alias.txt
+void PREDICTOR::aliasReport(){
+	std::ofstream out;
+	out.open("alias.txt", std::ios::app);
+	out<<"table tagBits hits falsePC falseCtx cold falseRate"<<std::endl;
+	for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+		aliasStat_t *st = &aliasStats[i];
+		out<<i<<" "<<tageTagSize[i]<<" "<<st->hits<<" "<<st->falsePC<<" "<<st->falseCtx<<" "<<st->cold<<" ";
+		out<<(st->hits ? (double)(st->falsePC + st->falseCtx + st->cold)/st->hits : 0.0)<<std::endl;
+	}
+	//same numbers grouped by tag width, widest first
+	out<<"tagBits hits falsePC falseCtx cold falseRate"<<std::endl;
+	for(UINT32 bits = 32; bits > 0; bits--) {
+		aliasStat_t sum = {0, 0, 0, 0};
+		bool found = false;
+		for(UINT32 i = 0; i < NUM_TAGE_TABLES; i++) {
+			if(tageTagSize[i] != bits)
+				continue;
+			found = true;
+			sum.hits += aliasStats[i].hits;
+			sum.falsePC += aliasStats[i].falsePC;
+			sum.falseCtx += aliasStats[i].falseCtx;
+			sum.cold += aliasStats[i].cold;
+		}
+		if(!found)
+			continue;
+		out<<bits<<" "<<sum.hits<<" "<<sum.falsePC<<" "<<sum.falseCtx<<" "<<sum.cold<<" ";
+		out<<(sum.hits ? (double)(sum.falsePC + sum.falseCtx + sum.cold)/sum.hits : 0.0)<<std::endl;
+	}
+	out<<std::endl;
+}
+
 void    PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget){
 
   // This function is called for instructions which are not
@@ -541,9 +1815,1063 @@ void    PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget)
   // a predictor that uses information from such instructions.
   // We expect most contestants to leave this function untouched.
 
-  return;
+	//indirect jumps and calls get their target predicted, then trained with the real one.
+	//The target tables hash the live CSRs, so they sit out runs on precomputed rows.
+	UINT32 target = 0;
+	bool predicted = false;
+	if(ITTAGE && opType == OPTYPE_INDIRECT_BR_CALL && !rowIndex) {
+		targetCtx_t ctx;
+		target = predictTarget(PC, &ctx);
+		predicted = true;
+		if(IT_STATS) {
+			++itIndirect;
+			if(target != branchTarget)
+				++itMiss;
+		}
+		trainTarget(&ctx, branchTarget);
+	}
+	if(FRONTEND)
+		frontendOther(PC, opType, branchTarget, predicted ? &target : NULL);
+	if(numThreads > 1)
+		++threads[thread].insts;
+	if(IT_STATS || FRONTEND) {
+		++insts;
+		if(IT_STATS && insts % IT_INTERVAL == 0)
+			targetReport();
+		if(FRONTEND && insts % FRONTEND_INTERVAL == 0)
+			frontendReport();
+	}
+	return;
+}
+
+//drop the private GHR and fold from ghr, which the caller shifts (see PREDICTOR_BASE). Thread rings,
+//speculative history and precomputed rows never read the GHR, so they are unaffected.
+bool PREDICTOR::shareHistory(bitset<1001> *ghr){
+	if(!historyShared)
+		delete GHR;
+	GHR = ghr;
+	historyShared = true;
+	return true;
+}
+
+//ITTAGE lookup: the target of the longest history entry that hits, unless it has no
+//confidence yet, in which case the next hit's (or the base table's) is used instead
+UINT32 PREDICTOR::predictTarget(UINT32 PC, targetCtx_t *ctx) const {
+	ctx->baseIndex = (PC ^ (PC >> IT_BASE_LOG)) & ((1 << IT_BASE_LOG) - 1);
+	const targetVal_t *base = &itBase[ctx->baseIndex];
+	ctx->provider = NUM_IT_TABLES;
+	int alt = NUM_IT_TABLES;
+	for(int i = 0; i < NUM_IT_TABLES; i++) {
+		UINT32 t = IT_TAGE_TABLE[i];
+		ctx->index[i] = hashIndex(PC, csrIndex[t].val, *PHR, IT_TABLE_LOG, 0);
+		ctx->tag[i] = hashTag(PC, csrTag[0][t].val, csrTag[1][t].val, IT_TAG_BITS);
+		if(itTables[i][ctx->index[i]].tag == ctx->tag[i]) {
+			if(ctx->provider == NUM_IT_TABLES)
+				ctx->provider = i;
+			else if(alt == NUM_IT_TABLES)
+				alt = i;
+		}
+	}
+	const targetVal_t *prov = (ctx->provider < NUM_IT_TABLES) ? &itTables[ctx->provider][ctx->index[ctx->provider]] : base;
+	const targetVal_t *altEntry = (alt < NUM_IT_TABLES) ? &itTables[alt][ctx->index[alt]] : base;
+	ctx->provTarget = (itRegions[prov->region] << IT_OFFSET_BITS) | prov->offset;
+	ctx->altTarget = (itRegions[altEntry->region] << IT_OFFSET_BITS) | altEntry->offset;
+	ctx->target = (prov->ctr == 0 && ctx->provider < NUM_IT_TABLES) ? ctx->altTarget : ctx->provTarget;
+	return ctx->target;
+}
+
+//train the provider (or base table) on the real target, and on a wrong prediction give the
+//branch an entry in a table with longer history than the provider's
+void PREDICTOR::trainTarget(const targetCtx_t *ctx, UINT32 target){
+	bool right = (ctx->provTarget == target);
+	if(ctx->provider < NUM_IT_TABLES) {
+		targetVal_t *prov = &itTables[ctx->provider][ctx->index[ctx->provider]];
+		if(right != (ctx->altTarget == target)) //useful if it's what told the two apart
+			prov->u = right;
+		setTarget(prov, target, right);
+	} else {
+		setTarget(&itBase[ctx->baseIndex], target, right);
+	}
+	if(ctx->target != target && ctx->provider > 0) {
+		int alloc = -1;
+		for(int i = ctx->provider - 1; i >= 0; i--) { //shortest of the longer histories first
+			if(itTables[i][ctx->index[i]].u == 0) {
+				alloc = i;
+				break;
+			}
+		}
+		if(alloc < 0) { //none free, make room for next time
+			for(int i = ctx->provider - 1; i >= 0; i--) {
+				itTables[i][ctx->index[i]].u = 0;
+			}
+		} else {
+			targetVal_t *entry = &itTables[alloc][ctx->index[alloc]];
+			entry->tag = ctx->tag[alloc];
+			entry->ctr = 0;
+			entry->u = 0;
+			entry->region = targetRegion(target);
+			entry->offset = target & ((1 << IT_OFFSET_BITS) - 1);
+		}
+	}
+	if(++itClock == (1 << IT_CLOCK_MAX)) {
+		itClock = 0;
+		for(int i = 0; i < NUM_IT_TABLES; i++) {
+			for(UINT32 j = 0; j < (1 << IT_TABLE_LOG); j++) {
+				itTables[i][j].u = 0;
+			}
+		}
+	}
+}
+
+//confidence counter of an entry, which takes the new target once it has none left
+void PREDICTOR::setTarget(targetVal_t *entry, UINT32 target, bool right){
+	if(right) {
+		if(entry->ctr < IT_CTR_MAX)
+			++(entry->ctr);
+	} else if(entry->ctr > 0) {
+		--(entry->ctr);
+	} else {
+		entry->region = targetRegion(target);
+		entry->offset = target & ((1 << IT_OFFSET_BITS) - 1);
+	}
+}
+
+//region table entry holding the high bits of target, replacing the oldest region if none does.
+//Entries still pointing at a replaced region predict wrong targets until they're retrained.
+UINT32 PREDICTOR::targetRegion(UINT32 target){
+	UINT32 high = target >> IT_OFFSET_BITS;
+	for(UINT32 i = 0; i < (1 << IT_REGION_LOG); i++) {
+		if(itRegions[i] == high)
+			return i;
+	}
+	UINT32 r = itRegionNext;
+	itRegionNext = (itRegionNext + 1) % (1 << IT_REGION_LOG);
+	itRegions[r] = high;
+	return r;
+}
+
+//write cumulative indirect branches, wrong targets and target MPKI into ittage.txt. Instructions
+//are the conditional branches plus everything TrackOtherInst sees.
+void PREDICTOR::targetReport(){
+	std::ofstream out;
+	out.open("ittage.txt", std::ios::app);
+	out<<"instructions "<<insts<<" indirect "<<itIndirect<<" miss "<<itMiss;
+	out<<" mpki "<<(insts ? 1000.0 * itMiss / insts : 0.0)<<std::endl;
+}
+
+//look PC up in the BTB, putting its target in target on a hit
+bool PREDICTOR::btbLookup(UINT32 PC, UINT32 *target){
+	UINT32 set = (PC ^ (PC >> BTB_SETS_LOG)) & ((1 << BTB_SETS_LOG) - 1); //the tag still tells PCs apart
+	UINT32 tag = ((PC >> BTB_SETS_LOG) & ((1 << BTB_TAG_BITS) - 1)) + 1; //+1 keeps 0 for empty
+	UINT32 hits = btbMatch(&btbTag[set * BTB_WAYS], tag);
+	++btbLookups;
+	if(!hits)
+		return false;
+	UINT32 way = set * BTB_WAYS + __builtin_ctz(hits);
+	++btbHits;
+	if(BTB_POLICY == BTB_LRU)
+		btbStamp[way] = ++btbTick;
+	*target = btbTarget[way];
+	return true;
+}
+
+//record PC's taken target, replacing an empty way first, then the one BTB_POLICY picks
+void PREDICTOR::btbUpdate(UINT32 PC, UINT32 target){
+	UINT32 set = (PC ^ (PC >> BTB_SETS_LOG)) & ((1 << BTB_SETS_LOG) - 1);
+	UINT32 tag = ((PC >> BTB_SETS_LOG) & ((1 << BTB_TAG_BITS) - 1)) + 1;
+	const UINT32 *tags = &btbTag[set * BTB_WAYS];
+	UINT32 hits = btbMatch(tags, tag);
+	UINT32 empty;
+	UINT32 way;
+	if(hits) {
+		way = __builtin_ctz(hits);
+	} else if((empty = btbMatch(tags, 0))) {
+		way = __builtin_ctz(empty);
+	} else if(BTB_POLICY == BTB_RANDOM) {
+		btbSeed = btbSeed * 1103515245 + 12345;
+		way = (btbSeed >> 16) % BTB_WAYS;
+	} else { //oldest use for LRU, oldest fill for FIFO
+		const UINT32 *stamps = &btbStamp[set * BTB_WAYS];
+		way = 0;
+		for(UINT32 w = 1; w < BTB_WAYS; w++) {
+			if(stamps[w] < stamps[way])
+				way = w;
+		}
+	}
+	way += set * BTB_WAYS;
+	if(!hits || BTB_POLICY == BTB_LRU) //FIFO only stamps fills
+		btbStamp[way] = ++btbTick;
+	btbTag[way] = tag;
+	btbTarget[way] = target;
+}
+
+//push a return address, pushing the oldest one out if the stack is full
+void PREDICTOR::rasPush(UINT32 addr){
+	rasTop = (rasTop + 1) % RAS_DEPTH;
+	rasStack[rasTop] = addr;
+	if(rasCount < RAS_DEPTH)
+		++rasCount;
+	else
+		++rasOverflow;
+}
+
+//pop the newest return address into addr, false if the stack is empty
+bool PREDICTOR::rasPop(UINT32 *addr){
+	if(rasCount == 0) {
+		++rasUnderflow;
+		return false;
+	}
+	*addr = rasStack[rasTop];
+	rasTop = (rasTop + RAS_DEPTH - 1) % RAS_DEPTH;
+	--rasCount;
+	return true;
+}
+
+//a conditional branch through the frontend: fetch goes the right way if the direction was right
+//and, when taken, the BTB knew the target
+void PREDICTOR::frontendBranch(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
+	UINT32 target = 0;
+	bool hit = btbLookup(PC, &target);
+	if(predDir != resolveDir)
+		++(redirects[REDIRECT_DIRECTION]);
+	else if(resolveDir && (!hit || target != branchTarget))
+		++(redirects[REDIRECT_BTB]);
+	if(resolveDir)
+		btbUpdate(PC, branchTarget);
+}
+
+//every other control transfer through the frontend. Indirect branches take ITTAGE's target if
+//there is one (indirectTarget), else the BTB's. Returns come off the RAS, calls push it; indirect
+//calls can't be told from indirect jumps, so they don't.
+void PREDICTOR::frontendOther(UINT32 PC, OpType opType, UINT32 branchTarget, const UINT32 *indirectTarget){
+	if(opType != OPTYPE_CALL_DIRECT && opType != OPTYPE_RET && opType != OPTYPE_BRANCH_UNCOND &&
+	   opType != OPTYPE_INDIRECT_BR_CALL)
+		return;
+	UINT32 target = 0;
+	bool hit = btbLookup(PC, &target); //the BTB is what says this is a branch at all
+	if(opType == OPTYPE_RET) {
+		UINT32 addr = 0;
+		++rasPops;
+		bool right = rasPop(&addr) && branchTarget > addr && branchTarget - addr <= RAS_CALL_BYTES;
+		if(right)
+			++rasRight;
+		if(!hit)
+			++(redirects[REDIRECT_BTB]);
+		else if(!right)
+			++(redirects[REDIRECT_RAS]);
+	} else if(opType == OPTYPE_INDIRECT_BR_CALL) {
+		if(!hit)
+			++(redirects[REDIRECT_BTB]);
+		else if((indirectTarget ? *indirectTarget : target) != branchTarget)
+			++(redirects[REDIRECT_INDIRECT]);
+	} else {
+		if(!hit || target != branchTarget)
+			++(redirects[REDIRECT_BTB]);
+		if(opType == OPTYPE_CALL_DIRECT)
+			rasPush(PC);
+	}
+	btbUpdate(PC, branchTarget);
+}
+
+//write cumulative BTB hit rate, RAS accuracy and fetch redirects per cause into frontend.txt
+void PREDICTOR::frontendReport(){
+	UINT64 total = 0;
+	for(int i = 0; i < NUM_REDIRECT_CAUSES; i++) {
+		total += redirects[i];
+	}
+	std::ofstream out;
+	out.open("frontend.txt", std::ios::app);
+	out<<"instructions "<<insts<<" btbLookups "<<btbLookups<<" btbHitRate ";
+	out<<(btbLookups ? (double)btbHits/btbLookups : 0.0)<<std::endl;
+	out<<"returns "<<rasPops<<" rasAccuracy "<<(rasPops ? (double)rasRight/rasPops : 0.0);
+	out<<" overflow "<<rasOverflow<<" underflow "<<rasUnderflow<<std::endl;
+	out<<"redirects "<<total<<" direction "<<redirects[REDIRECT_DIRECTION]<<" btb "<<redirects[REDIRECT_BTB];
+	out<<" ras "<<redirects[REDIRECT_RAS]<<" indirect "<<redirects[REDIRECT_INDIRECT];
+	out<<" perKilo "<<(insts ? 1000.0 * total / insts : 0.0)<<std::endl<<std::endl;
+}
+
+//GetPrediction, with the fast table's prediction the full one overrides in fastDir. Both come
+//from the one lookup, and the fast table trains in the same update.
+bool PREDICTOR::predictOverride(UINT32 PC, bool *fastDir){
+	bool predDir = PREDICTOR::GetPrediction(PC);
+	*fastDir = fastPred;
+	return predDir;
+}
+
+//fetch cycles an override loses and cycles a mispredict loses, for the override report
+void PREDICTOR::setOverrideCost(UINT32 bubble, UINT32 penalty){
+	ovBubble = bubble;
+	ovPenalty = penalty;
+}
+
+//count whether the full prediction overrode the fast one and whether that paid off, then
+//train the fast table with every resolved branch. Under an update delay UpdatePredictor queues
+//that write with the others instead
+void PREDICTOR::overrideBranch(UINT32 PC, bool resolveDir, bool predDir){
+	++ovBranches;
+	if(fastPred != resolveDir)
+		++fastMiss;
+	if(predDir != resolveDir)
+		++slowMiss;
+	if(fastPred != predDir) {
+		++ovOverrides;
+		if(predDir == resolveDir)
+			++ovFixed;
+		else
+			++ovBroke;
+	}
+	if(!updQueue)
+		bimodalTrain(&fastTable[(PC) % (numBimodalEntries)], resolveDir);
+	if(ovBranches % OVERRIDE_INTERVAL == 0)
+		overrideReport();
+}
+
+//write the override counts to override.txt, and the cycles lost fetching on the bimodal alone
+//next to fetching on it and overriding it: every override costs a bubble, every
+//mispredict left over costs the penalty
+void PREDICTOR::overrideReport(){
+	UINT64 fastCycles = fastMiss * ovPenalty;
+	UINT64 overrideCycles = ovOverrides * ovBubble + slowMiss * ovPenalty;
+	std::ofstream out;
+	out.open("override.txt", std::ios::app);
+	out<<"branches "<<ovBranches<<" overrides "<<ovOverrides<<" fixed "<<ovFixed<<" broke "<<ovBroke<<std::endl;
+	out<<"fastMiss "<<fastMiss<<" slowMiss "<<slowMiss<<" bubble "<<ovBubble<<" penalty "<<ovPenalty<<std::endl;
+	out<<"cyclesLost fast "<<fastCycles<<" overriding "<<overrideCycles<<" bubbles "<<ovOverrides * ovBubble;
+	out<<" perBranch "<<(ovBranches ? (double)overrideCycles / ovBranches : 0.0)<<std::endl<<std::endl;
 }
 
 
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
+
+INDEX_STREAM::INDEX_STREAM(void){
+	n = 0;
+	key = 0;
+	index = NULL;
+	tag = NULL;
+}
+
+INDEX_STREAM::~INDEX_STREAM(void){
+	delete[] index;
+	delete[] tag;
+}
+
+void INDEX_STREAM::alloc(UINT64 n){
+	delete[] index;
+	delete[] tag;
+	this->n = n;
+	index = new UINT32[n * NUM_TAGE_TABLES];
+	tag = new UINT16[n * NUM_TAGE_TABLES];
+}
+
+//FNV-1a over everything the stream depends on, so a saved stream is never reused for
+//another trace or another table geometry
+UINT64 INDEX_STREAM::makeKey(const UINT32 *PCs, const bool *dirs, UINT64 n){
+	UINT64 h = 14695981039346656037ULL;
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		h = (h ^ (TAGE_TABLE_BITS[i] + TAGE_TABLE_GROW)) * 1099511628211ULL;
+		h = (h ^ TAGE_TAG_BITS[i]) * 1099511628211ULL;
+		h = (h ^ TAGE_HIST_LENS[i]) * 1099511628211ULL;
+	}
+	h = (h ^ PHR_LEN) * 1099511628211ULL;
+	h = (h ^ n) * 1099511628211ULL;
+	for(UINT64 k = 0; k < n; k++) {
+		h = (h ^ ((PCs[k] << 1) | dirs[k])) * 1099511628211ULL;
+	}
+	return h;
+}
+
+//hash branches begin..end-1. History starts empty STREAM_WARMUP branches earlier, which is
+//enough for every CSR and the PHR to match what a predictor run from the start would hold.
+void INDEX_STREAM::buildChunk(const UINT32 *PCs, const bool *dirs, UINT64 begin, UINT64 end){
+	bitset<1001> GHR;
+	UINT32 PHR = 0;
+	csr_t csrIndex[NUM_TAGE_TABLES];
+	csr_t csrTag[2][NUM_TAGE_TABLES];
+	for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+		csrIndex[i].val = csrTag[0][i].val = csrTag[1][i].val = 0;
+		csrIndex[i].origLen = csrTag[0][i].origLen = csrTag[1][i].origLen = TAGE_HIST_LENS[i];
+		csrIndex[i].newLen = csrTag[0][i].newLen = TAGE_TAG_BITS[i];
+		csrTag[1][i].newLen = TAGE_TAG_BITS[i] - 1;
+	}
+	for(UINT64 k = (begin > STREAM_WARMUP) ? begin - STREAM_WARMUP : 0; k < end; k++) {
+		if(k >= begin) {
+			UINT32 *indexOut = &index[k * NUM_TAGE_TABLES];
+			UINT16 *tagOut = &tag[k * NUM_TAGE_TABLES];
+			for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+				tagOut[i] = hashTag(PCs[k], csrTag[0][i].val, csrTag[1][i].val, TAGE_TAG_BITS[i]);
+				indexOut[i] = hashIndex(PCs[k], csrIndex[i].val, PHR, TAGE_TABLE_BITS[i] + TAGE_TABLE_GROW, 0);
+			}
+		}
+		GHR <<= 1;
+		if(dirs[k] == TAKEN)
+			GHR.set(0, 1);
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			foldHistory(&csrIndex[i], GHR);
+			foldHistory(&csrTag[0][i], GHR);
+			foldHistory(&csrTag[1][i], GHR);
+		}
+		PHR = pathHistory(PHR, PCs[k]);
+	}
+}
+
+//hash the n branches of a trace, split into one chunk per thread
+void INDEX_STREAM::build(const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads){
+	alloc(n);
+	key = makeKey(PCs, dirs, n);
+	if(threads == 0)
+		threads = 1;
+	UINT64 chunk = (n + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for(UINT64 begin = 0; begin < n; begin += chunk) {
+		UINT64 end = (begin + chunk < n) ? begin + chunk : n;
+		workers.push_back(std::thread(&INDEX_STREAM::buildChunk, this, PCs, dirs, begin, end));
+	}
+	for(UINT32 i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+//reuse the stream saved in file if it matches this trace, otherwise build and save it
+void INDEX_STREAM::buildCached(const char *file, const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads){
+	if(load(file, PCs, dirs, n))
+		return;
+	build(PCs, dirs, n, threads);
+	if(!save(file))
+		fprintf(stderr, "couldn't save index stream to %s\n", file);
+}
+
+bool INDEX_STREAM::load(const char *file, const UINT32 *PCs, const bool *dirs, UINT64 n){
+	FILE *in = fopen(file, "rb");
+	if(!in)
+		return false;
+	UINT32 magic = 0;
+	UINT64 fileKey = 0, fileN = 0;
+	bool ok = fread(&magic, sizeof(magic), 1, in) == 1 &&
+	          fread(&fileKey, sizeof(fileKey), 1, in) == 1 &&
+	          fread(&fileN, sizeof(fileN), 1, in) == 1 &&
+	          magic == STREAM_MAGIC && fileN == n && fileKey == makeKey(PCs, dirs, n);
+	if(ok) {
+		alloc(n);
+		key = fileKey;
+		ok = fread(index, sizeof(UINT32), n * NUM_TAGE_TABLES, in) == n * NUM_TAGE_TABLES &&
+		     fread(tag, sizeof(UINT16), n * NUM_TAGE_TABLES, in) == n * NUM_TAGE_TABLES;
+		if(!ok)
+			this->n = 0;
+	}
+	fclose(in);
+	return ok;
+}
+
+bool INDEX_STREAM::save(const char *file){
+	FILE *out = fopen(file, "wb");
+	if(!out)
+		return false;
+	UINT32 magic = STREAM_MAGIC;
+	bool ok = fwrite(&magic, sizeof(magic), 1, out) == 1 &&
+	          fwrite(&key, sizeof(key), 1, out) == 1 &&
+	          fwrite(&n, sizeof(n), 1, out) == 1 &&
+	          fwrite(index, sizeof(UINT32), n * NUM_TAGE_TABLES, out) == n * NUM_TAGE_TABLES &&
+	          fwrite(tag, sizeof(UINT16), n * NUM_TAGE_TABLES, out) == n * NUM_TAGE_TABLES;
+	return (fclose(out) == 0) && ok;
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+//run each instance to the end of its trace, one after another
+void runSequential(instance_t *runs, UINT32 count){
+	for(UINT32 g = 0; g < count; g++) {
+		instance_t *run = &runs[g];
+		run->miss = 0;
+		for(UINT64 k = 0; k < run->n; k++) {
+			bool predDir = run->p->GetPrediction(run->PCs[k]);
+			if(predDir != run->dirs[k])
+				++(run->miss);
+			run->p->UpdatePredictor(run->PCs[k], run->dirs[k], predDir, 0); //target is unused
+		}
+	}
+}
+
+//advance instances group at a time, one branch each per round. Every round first prefetches
+//each instance's next branch, then predicts and updates them in turn, so one instance's
+//table misses are in flight while the others compute. Each instance draws its allocations
+//from its own lcg, so its misses are the same as running it alone.
+void runInterleaved(instance_t *runs, UINT32 count, UINT32 group){
+	if(group == 0)
+		group = 1;
+	for(UINT32 first = 0; first < count; first += group) {
+		UINT32 last = (first + group < count) ? first + group : count;
+		UINT64 longest = 0;
+		for(UINT32 g = first; g < last; g++) {
+			runs[g].miss = 0;
+			if(runs[g].n > longest)
+				longest = runs[g].n;
+		}
+		for(UINT64 k = 0; k < longest; k++) {
+			for(UINT32 g = first; g < last; g++) {
+				if(k < runs[g].n)
+					runs[g].p->prefetchBranch(runs[g].PCs[k]);
+			}
+			for(UINT32 g = first; g < last; g++) {
+				instance_t *run = &runs[g];
+				if(k >= run->n)
+					continue;
+				bool predDir = run->p->GetPrediction(run->PCs[k]);
+				if(predDir != run->dirs[k])
+					++(run->miss);
+				run->p->UpdatePredictor(run->PCs[k], run->dirs[k], predDir, 0); //target is unused
+			}
+		}
+	}
+}
+
+//run count threads' traces interleaved on one predictor, as an SMT core (or cores sharing
+//the tables) would. Each thread predicts on its own history, and the running thread switches
+//every quantum branches (SMT_ROUND_ROBIN) or instructions (SMT_BY_INSTS), skipping threads
+//that are done. Writes the per-thread MPKI to smt.txt.
+void runSMT(PREDICTOR *p, smtThread_t *threads, UINT32 count, int policy, UINT32 quantum){
+	if(quantum == 0)
+		quantum = 1;
+	p->setThreads(count);
+	std::vector<UINT64> pos(count, 0);         //next branch of each thread
+	std::vector<UINT32> gapDone(count, 0);     //instructions of that branch's gap already run
+	UINT32 running = 0;
+	for(UINT32 t = 0; t < count; t++) {
+		threads[t].miss = 0;
+		if(threads[t].n)
+			++running;
+	}
+	for(UINT32 t = 0; running; t = (t + 1) % count) {
+		smtThread_t *th = &threads[t];
+		if(pos[t] >= th->n)
+			continue;
+		p->setThread(t);
+		for(UINT32 used = 0; used < quantum && pos[t] < th->n; ) {
+			UINT64 k = pos[t];
+			if(th->gaps && gapDone[t] < th->gaps[k]) { //the instructions before the branch
+				p->TrackOtherInst(th->PCs[k], OPTYPE_OP, 0);
+				++gapDone[t];
+				if(policy == SMT_BY_INSTS)
+					++used;
+				continue;
+			}
+			bool predDir = p->GetPrediction(th->PCs[k]);
+			if(predDir != th->dirs[k])
+				++(th->miss);
+			p->UpdatePredictor(th->PCs[k], th->dirs[k], predDir, 0); //target is unused
+			gapDone[t] = 0;
+			++used;
+			if(++pos[t] == th->n)
+				--running;
+		}
+	}
+	p->threadReport();
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+//one branch of the trace as a shard replays it: the low PC bits the study's tables read,
+//shifted up past the direction in bit 0
+typedef UINT32 studyBranch_t;
+static_assert(BIMODAL_SIZE < 32 && LOOP_TABLE_SIZE < 32 && LOOP_TAG_SIZE < 32, "a bucketed branch keeps 31 PC bits");
+
+//the private table of one shard of a component study and what it has replayed so far
+typedef struct studyShard{
+	int component;
+	bimodVal_t *bimodal;
+	loopVal_t *loopTable;
+	studyStats_t stats;
+} studyShard_t;
+
+static void studyOpen(int component, studyShard_t *shard){
+	shard->component = component;
+	shard->bimodal = NULL;
+	shard->loopTable = NULL;
+	shard->stats.branches = 0;
+	shard->stats.predicted = 0;
+	shard->stats.miss = 0;
+	if(component == STUDY_BIMODAL) {
+		shard->bimodal = new bimodVal_t[1 << BIMODAL_SIZE];
+		for(UINT32 i = 0; i < (1u << BIMODAL_SIZE); i++) {
+			shard->bimodal[i].pred = BIMODAL_PRED_INIT;
+		}
+	} else {
+		shard->loopTable = new loopVal_t[1 << LOOP_TABLE_SIZE];
+		for(UINT32 i = 0; i < (1u << LOOP_TABLE_SIZE); i++) {
+			shard->loopTable[i].loopCount = 0;
+			shard->loopTable[i].currentIter = 0;
+			shard->loopTable[i].tag = 0;
+			shard->loopTable[i].conf = 0;
+			shard->loopTable[i].age = 0;
+			shard->loopTable[i].pred = false;
+			shard->loopTable[i].used = false;
+		}
+	}
+}
+
+static void studyClose(studyShard_t *shard){
+	delete[] shard->bimodal;
+	delete[] shard->loopTable;
+}
+
+//predict and train one branch on the shard's table
+static inline void studyStep(studyShard_t *shard, UINT32 PC, bool dir){
+	++(shard->stats.branches);
+	if(shard->component == STUDY_BIMODAL) {
+		bimodVal_t *entry = &shard->bimodal[(PC) % (1 << BIMODAL_SIZE)];
+		++(shard->stats.predicted);
+		if(bimodalPredict(entry) != dir)
+			++(shard->stats.miss);
+		bimodalTrain(entry, dir);
+	} else {
+		loopVal_t *entry = &shard->loopTable[(PC) % (1 << LOOP_TABLE_SIZE)];
+		bool loopPred;
+		bool loopUsed = loopLookup(entry, PC, &loopPred);
+		if(loopUsed) {
+			++(shard->stats.predicted);
+			if(loopPred != dir)
+				++(shard->stats.miss);
+		}
+		loopTrain(entry, PC, dir, loopPred, loopUsed);
+	}
+}
+
+//split chunk [begin, end) of the trace into one bucket per shard by entry index, keeping
+//trace order in each
+static void bucketChunk(int component, const UINT32 *PCs, const bool *dirs, UINT64 begin, UINT64 end,
+                        UINT32 shards, std::vector<studyBranch_t> *buckets){
+	UINT32 numEntries = (component == STUDY_BIMODAL) ? (1 << BIMODAL_SIZE) : (1 << LOOP_TABLE_SIZE);
+	for(UINT32 s = 0; s < shards; s++) {
+		buckets[s].reserve((end - begin) / shards + (end - begin) / (4 * shards) + 1);
+	}
+	for(UINT64 k = begin; k < end; k++) {
+		buckets[((PCs[k]) % (numEntries)) % shards].push_back((PCs[k] << 1) | dirs[k]);
+	}
+}
+
+//replay shard s from every chunk's bucket for it, chunks in trace order. Every entry only ever
+//sees its own branches, in trace order, so it ends up exactly as it would sequentially.
+static void replayShard(int component, std::vector<studyBranch_t> *const *chunkBuckets, UINT32 chunks,
+                        UINT32 s, studyStats_t *stats){
+	studyShard_t shard;
+	studyOpen(component, &shard);
+	for(UINT32 c = 0; c < chunks; c++) {
+		const std::vector<studyBranch_t> &bucket = chunkBuckets[c][s];
+		for(UINT64 b = 0; b < bucket.size(); b++) {
+			studyStep(&shard, bucket[b] >> 1, bucket[b] & 1);
+		}
+	}
+	*stats = shard.stats;
+	studyClose(&shard);
+}
+
+//bimodal-only or loop-only study of a trace. Both tables are indexed by PC alone, so the
+//trace is split by entry index into one shard per thread: every thread first buckets a chunk
+//of the trace by shard, then replays one shard from every chunk's bucket for it, and the
+//shard stats are summed, giving the same totals as a single thread. The loop study replays a
+//direct-mapped table, so it needs LOOP_WAYS 1.
+studyStats_t replayComponent(int component, const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads){
+	if(threads == 0)
+		threads = 1;
+	if(component == STUDY_LOOP && LOOP_WAYS != 1) {
+		fprintf(stderr, "the loop study replays a direct-mapped loop table, build with LOOP_WAYS 1\n");
+		exit(1);
+	}
+	if(threads == 1) { //nothing to split
+		studyShard_t shard;
+		studyOpen(component, &shard);
+		for(UINT64 k = 0; k < n; k++) {
+			studyStep(&shard, PCs[k], dirs[k]);
+		}
+		studyStats_t total = shard.stats;
+		studyClose(&shard);
+		return total;
+	}
+	std::vector<studyBranch_t> **chunkBuckets = new std::vector<studyBranch_t>*[threads];
+	std::vector<std::thread> workers;
+	for(UINT32 t = 0; t < threads; t++) {
+		chunkBuckets[t] = new std::vector<studyBranch_t>[threads];
+		workers.push_back(std::thread(bucketChunk, component, PCs, dirs, n * t / threads, n * (t + 1) / threads,
+		                              threads, chunkBuckets[t]));
+	}
+	for(UINT32 t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+	workers.clear();
+	studyStats_t *shardStats = new studyStats_t[threads];
+	for(UINT32 t = 0; t < threads; t++) {
+		workers.push_back(std::thread(replayShard, component, chunkBuckets, threads, t, &shardStats[t]));
+	}
+	studyStats_t total;
+	total.branches = 0;
+	total.predicted = 0;
+	total.miss = 0;
+	for(UINT32 t = 0; t < threads; t++) {
+		workers[t].join();
+		total.branches += shardStats[t].branches;
+		total.predicted += shardStats[t].predicted;
+		total.miss += shardStats[t].miss;
+	}
+	for(UINT32 t = 0; t < threads; t++) {
+		delete[] chunkBuckets[t];
+	}
+	delete[] chunkBuckets;
+	delete[] shardStats;
+	return total;
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+//spread every input bit over the whole word
+static inline UINT64 mix64(UINT64 x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+//unbounded table of the oracle: an open-addressing hash map from a key to a value of valueBits,
+//both packed into one word. The slots are one flat array probed linearly from a Fibonacci hash
+//of the key, so an entry costs 8 bytes and no allocation of its own, and a lookup usually
+//reads one cache line.
+class ORACLE_MAP{
+private:
+	UINT64 *slots;                        //key << valueBits | value, 0 for an empty slot
+	UINT32 valueBits;
+	UINT32 log;                           //2^log slots
+	UINT64 used;
+
+	UINT64 start(UINT64 key) const {
+		return (key * ORACLE_HIST_MULT) >> (64 - log);
+	}
+
+	//double the slots and put every entry back
+	void grow(){
+		UINT64 *old = slots;
+		UINT64 oldSize = 1ULL << log;
+		++log;
+		UINT64 mask = (1ULL << log) - 1;
+		slots = new UINT64[mask + 1]();
+		for(UINT64 i = 0; i < oldSize; i++) {
+			if(!old[i])
+				continue;
+			UINT64 j = start(old[i] >> valueBits);
+			while(slots[j])
+				j = (j + 1) & mask;
+			slots[j] = old[i];
+		}
+		delete[] old;
+	}
+
+public:
+	//keys have to be nonzero and fit in 64 - valueBits bits
+	ORACLE_MAP(UINT32 valueBits){
+		this->valueBits = valueBits;
+		log = ORACLE_MAP_LOG;
+		slots = new UINT64[1ULL << log]();
+		used = 0;
+	}
+
+	~ORACLE_MAP(){
+		delete[] slots;
+	}
+
+	//key's slot, NULL if it has none
+	UINT64 *find(UINT64 key){
+		UINT64 mask = (1ULL << log) - 1;
+		for(UINT64 i = start(key); slots[i]; i = (i + 1) & mask) {
+			if((slots[i] >> valueBits) == key)
+				return &slots[i];
+		}
+		return NULL;
+	}
+
+	//add key, which isn't in the map yet, with value and return its slot
+	UINT64 *insert(UINT64 key, UINT64 value){
+		if(used + 1 > (3ULL << log) / 4)
+			grow();
+		UINT64 mask = (1ULL << log) - 1;
+		UINT64 i = start(key);
+		while(slots[i])
+			i = (i + 1) & mask;
+		slots[i] = (key << valueBits) | value;
+		++used;
+		return &slots[i];
+	}
+
+	//AND every value with mask, keys stay as they are
+	void maskValues(UINT64 mask){
+		UINT64 keep = (~0ULL << valueBits) | mask;
+		for(UINT64 i = 0; i < (1ULL << log); i++) {
+			slots[i] &= keep;
+		}
+	}
+
+	UINT64 size() const {
+		return used;
+	}
+
+	UINT64 hostBytes() const {
+		return (1ULL << log) * sizeof(UINT64);
+	}
+};
+
+//LTAGE with unbounded tables: every tagged table holds every (PC, history) context it
+//allocates and never evicts one. The bimodal and loop tables have an entry per PC, keyed by the
+//whole PC. A tagged entry's key is not the exact PC and history but a 59 bit hash of the PC and
+//a 64 bit rolling hash of the table's history (see key()), so two contexts can still share an
+//entry, with odds around n^2 / 2^60 for n contexts. Lookup and training follow lookup() and
+//train() (with SC off) rule for rule; only the table backing and the history lengths differ.
+//Each table's history is a rolling hash of its last histLen outcomes, updated in O(1) per
+//branch however long the history is.
+static_assert(TAGE_PRED_MAX <= 7 && PRED_U_MAX <= 3, "an oracle entry packs a 3 bit counter and 2 u bits");
+
+class ORACLE_TAGE{
+private:
+	ORACLE_MAP *tables[NUM_TAGE_TABLES];  //longest history first, like the real tables, u << 3 | counter
+	ORACLE_MAP *bimodal;                  //PC to its counter
+	ORACLE_MAP *loopSlots;                //PC to its entry in loopEntries
+	std::vector<loopVal_t> loopEntries;   //a loop entry per PC
+	UINT32 seed;                          //allocation draws, the same lcg as PREDICTOR::nextTenth
+	UINT32 histLen[NUM_TAGE_TABLES];
+	UINT64 hist[NUM_TAGE_TABLES];         //sum of outcome j * ORACLE_HIST_MULT^j over the last histLen outcomes
+	UINT64 drop[NUM_TAGE_TABLES];         //ORACLE_HIST_MULT^histLen, the weight an outcome leaves with
+	bool *ring;                           //the newest outcomes, enough for the longest history
+	UINT32 ringMask;
+	UINT32 head;                          //newest outcome in ring
+	int altBetterCount;
+	UINT32 clock;
+	bool clockState;
+
+	//59 bit hash of the PC and a history hash, never 0. A hash, not a tag: contexts can collide
+	static UINT64 key(UINT64 hist, UINT32 PC){
+		return (mix64(hist + PC * 0xff51afd7ed558ccdULL) >> 5) | 1;
+	}
+
+	static UINT32 ctr(UINT64 slot){
+		return slot & 7;
+	}
+
+	static UINT32 useful(UINT64 slot){
+		return (slot >> 3) & 3;
+	}
+
+	static void train(UINT64 *slot, bool resolveDir, UINT32 max){
+		if(resolveDir && ctr(*slot) < max)
+			++(*slot);
+		else if(!resolveDir && ctr(*slot) > 0)
+			--(*slot);
+	}
+
+	//draws like PREDICTOR::nextTenth
+	UINT32 nextTenth(){
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % 10;
+	}
+
+	void pushHistory(bool resolveDir){
+		head = (head + 1) & ringMask;
+		ring[head] = resolveDir;
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			bool oldest = ring[(head - histLen[i]) & ringMask];
+			hist[i] = hist[i] * ORACLE_HIST_MULT + resolveDir - oldest * drop[i];
+		}
+	}
+
+public:
+	//histories of histScale times the real lengths. That's all the oracle's history is, its
+	//lengths are not unlimited
+	ORACLE_TAGE(UINT32 histScale){
+		if(histScale == 0)
+			histScale = 1;
+		UINT32 ringSize = 1;
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			tables[i] = new ORACLE_MAP(5);
+			histLen[i] = TAGE_HIST_LENS[i] * histScale;
+			hist[i] = 0;
+			drop[i] = 1;
+			for(UINT32 j = 0; j < histLen[i]; j++) {
+				drop[i] *= ORACLE_HIST_MULT;
+			}
+			while(ringSize <= histLen[i])
+				ringSize <<= 1;
+		}
+		bimodal = new ORACLE_MAP(3);
+		loopSlots = new ORACLE_MAP(31);
+		seed = 1;
+		ring = new bool[ringSize]();
+		ringMask = ringSize - 1;
+		head = 0;
+		altBetterCount = ALTPRED_BET_INIT;
+		clock = 0;
+		clockState = 0;
+	}
+
+	~ORACLE_TAGE(){
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			delete tables[i];
+		}
+		delete bimodal;
+		delete loopSlots;
+		delete[] ring;
+	}
+
+	//predict the branch, train on its outcome and return the prediction
+	bool predictUpdate(UINT32 PC, bool resolveDir){
+		UINT64 *loopSlot = loopSlots->find((UINT64)PC + 1);
+		if(!loopSlot) {
+			loopVal_t blank = {0, 0, 0, 0, 0, false, false};
+			loopEntries.push_back(blank);
+			loopSlot = loopSlots->insert((UINT64)PC + 1, loopEntries.size() - 1);
+		}
+		loopVal_t *loop = &loopEntries[*loopSlot & ((1u << 31) - 1)];
+		bool loopPred;
+		bool loopUsed = loopLookup(loop, PC, &loopPred);
+		UINT64 *base = bimodal->find((UINT64)PC + 1);
+		if(!base)
+			base = bimodal->insert((UINT64)PC + 1, BIMODAL_PRED_INIT);
+
+		//lookup(): the longest hit provides, the next one is the alt
+		UINT64 keys[NUM_TAGE_TABLES];
+		UINT64 *provider = NULL, *alt = NULL;
+		int table = NUM_TAGE_TABLES;
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) { //allocation only needs the keys down to the provider
+			keys[i] = key(hist[i], PC);
+			UINT64 *slot = tables[i]->find(keys[i]);
+			if(!slot)
+				continue;
+			if(provider) {
+				alt = slot;
+				break;
+			}
+			provider = slot;
+			table = i;
+		}
+		bool altPred = alt ? ctr(*alt) >= TAGE_PRED_MAX/2 : ctr(*base) > BIMODAL_PRED_MAX/2;
+		bool providerPred = true; //lookup() leaves it at -1 when the alt is used
+		bool tageDir = altPred;
+		if(provider) {
+			UINT32 pred = ctr(*provider);
+			if((pred != WEAKLY_NOT_TAKEN) || (pred != WEAKLY_TAKEN) || (useful(*provider) != 0) ||
+			   (altBetterCount < ALTPRED_BET_INIT)) {
+				providerPred = pred >= TAGE_PRED_MAX/2;
+				tageDir = providerPred;
+			}
+		}
+		bool predDir = loopUsed ? loopPred : tageDir;
+
+		//train(): TAGE sits out the branches the loop entry provided
+		if(loopTrain(loop, PC, resolveDir, loopPred, loopUsed)) {
+			pushHistory(resolveDir);
+			return predDir;
+		}
+		if(provider) {
+			train(provider, resolveDir, TAGE_PRED_MAX);
+			if(useful(*provider) == 0 && alt)
+				train(alt, resolveDir, TAGE_PRED_MAX);
+		} else {
+			train(base, resolveDir, BIMODAL_PRED_MAX);
+		}
+		if(provider && useful(*provider) == 0 &&
+		   (ctr(*provider) == WEAKLY_NOT_TAKEN || ctr(*provider) == WEAKLY_TAKEN)) { //new in its table
+			if(providerPred != altPred) {
+				if(altPred == resolveDir) {
+					if(altBetterCount < ALTPRED_BET_MAX)
+						altBetterCount++;
+				} else if(altBetterCount > 0) {
+					altBetterCount--;
+				}
+			}
+		}
+		//a mispredict walks the longer tables from the provider up. They all missed, and a
+		//missing entry is a free one (u == 0), so there is always one to allocate and the u
+		//decrement train() falls back on has nothing to age.
+		if(tageDir != resolveDir && table > 0) {
+			for(int i = table - 1; i >= 0; i--) {
+				if(!nextTenth()) {
+					tables[i]->insert(keys[i], resolveDir ? WEAKLY_TAKEN : WEAKLY_NOT_TAKEN);
+					break;
+				}
+			}
+		}
+		if(provider && tageDir != altPred) { //the provider was used, keep it if it was right
+			if(tageDir == resolveDir && useful(*provider) < PRED_U_MAX)
+				*provider += 1 << 3;
+			else if(tageDir != resolveDir && useful(*provider) > 0)
+				*provider -= 1 << 3;
+		}
+		//clear the low, then the high u bit of every entry each 2^CLOCK_MAX branches
+		if(++clock == (1 << CLOCK_MAX)) {
+			clock = 0;
+			clockState = !clockState;
+			for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+				tables[i]->maskValues(7 | ((clockState + 1) << 3));
+			}
+		}
+		pushHistory(resolveDir);
+		return predDir;
+	}
+
+	UINT64 entries() const {
+		UINT64 total = bimodal->size() + loopSlots->size();
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			total += tables[i]->size();
+		}
+		return total;
+	}
+
+	UINT64 hostBytes() const {
+		UINT64 total = bimodal->hostBytes() + loopSlots->hostBytes() +
+		               loopEntries.capacity() * sizeof(loopVal_t) + (ringMask + 1) * sizeof(bool);
+		for(int i = 0; i < NUM_TAGE_TABLES; i++) {
+			total += tables[i]->hostBytes();
+		}
+		return total;
+	}
+};
+
+//run p on the trace as configured (in a thread of its own) and the unbounded oracle next to
+//it, then append both MPKIs to limit.txt under the trace's name. The oracle's tables are
+//unbounded, its histories are not: they are histScale times the real ones. insts of 0 takes
+//the branches as the instruction count.
+limitStats_t limitStudy(PREDICTOR *p, const char *trace, const UINT32 *PCs, const bool *dirs, UINT64 n,
+                        UINT64 insts, UINT32 histScale){
+	instance_t run;
+	run.p = p;
+	run.PCs = PCs;
+	run.dirs = dirs;
+	run.n = n;
+	run.miss = 0;
+	std::thread real(runSequential, &run, 1);
+	ORACLE_TAGE *oracle = new ORACLE_TAGE(histScale);
+	limitStats_t stats;
+	stats.branches = n;
+	stats.insts = insts ? insts : n;
+	stats.oracleMiss = 0;
+	for(UINT64 k = 0; k < n; k++) {
+		if(oracle->predictUpdate(PCs[k], dirs[k]) != dirs[k])
+			++stats.oracleMiss;
+	}
+	stats.entries = oracle->entries();
+	stats.hostBytes = oracle->hostBytes();
+	delete oracle;
+	real.join();
+	stats.realMiss = run.miss;
+
+	std::ofstream out("limit.txt", std::ios_base::app);
+	out<<"trace "<<trace<<" branches "<<stats.branches<<" instructions "<<stats.insts<<std::endl;
+	out<<"real miss "<<stats.realMiss<<" mpki "<<1000.0 * stats.realMiss / stats.insts;
+	out<<" oracle miss "<<stats.oracleMiss<<" mpki "<<1000.0 * stats.oracleMiss / stats.insts;
+	out<<" histScale "<<(histScale ? histScale : 1)<<" entries "<<stats.entries<<" hostBytes "<<stats.hostBytes<<std::endl<<std::endl;
+	return stats;
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+} // namespace ltageFinal
@@ -1,15 +1,36 @@
 //Jayson Boubin, Dec 2017
-#ifndef _PREDICTOR_H_
-#define _PREDICTOR_H_
+#ifndef _LTAGE_FINAL_H_
+#define _LTAGE_FINAL_H_
 
 #include "utils.h"
 #include "tracer.h"
+#include "predictorBase.h"
 #include <bitset>
-
-#define NUM_TAGE_TABLES 12
+#include <cstdint>
 
 #define UINT16	     unsigned short int
 
+class PREDICTOR_BENCH; //LTAGE-bench.cc, a friend of PREDICTOR
+
+namespace ltageFinal {
+
+const int NUM_TAGE_TABLES = 12;
+const int NUM_SC_TABLES = 4;           //GEHL tables of the statistical corrector, the bias table comes on top
+const int NUM_IT_TABLES = 6;           //tagged tables of the indirect target predictor
+
+//why the frontend model had to redirect fetch
+const int REDIRECT_DIRECTION = 0;      //conditional branch went the other way
+const int REDIRECT_BTB = 1;            //taken branch missed the BTB or it had the wrong target
+const int REDIRECT_RAS = 2;            //return address stack was wrong or empty
+const int REDIRECT_INDIRECT = 3;       //indirect branch went somewhere else
+const int NUM_REDIRECT_CAUSES = 4;
+
+//confidence classes of a prediction
+const int CONF_HIGH = 0;
+const int CONF_MEDIUM = 1;
+const int CONF_LOW = 2;
+const int NUM_CONF_CLASSES = 3;
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 //Circular Shift Register for folding purposes
@@ -39,6 +60,69 @@ typedef struct prediction{
 	UINT32 altIndex;
 } prediction_t;
 
+//everything UpdatePredictor needs from the lookup of one branch, so several branches can be
+//in flight between predict() and update()
+typedef struct predToken{
+	prediction_t pred;                    //provider and alternate
+	UINT32 index[NUM_TAGE_TABLES];        //index into each table
+	UINT16 tag[NUM_TAGE_TABLES];          //tag for each table
+	bool loopPred;                        //the loop predictor's prediction
+	bool loopUsed;                        //the loop predictor provided the prediction
+	bool predDir;                         //the prediction returned
+	bool fastPred;                        //the fast table's one cycle prediction, which predDir overrides
+	int conf;                             //its confidence class
+	UINT16 scIndex[NUM_SC_TABLES + 1];    //corrector weight read from each table, bias table last (only used if SC isn't 0)
+	int scSum;                            //the corrector's sum
+	bool tagePred;                        //TAGE's prediction, before the corrector had its say
+	UINT32 ckpt;                          //history checkpoint (only used if SPEC_HISTORY isn't 0)
+} predToken_t;
+
+//history to roll back to if a branch turns out mispredicted. Speculative GHR bits only go
+//into a ring, so a position in it stands in for the whole 1001 bit GHR.
+typedef struct histCkpt{
+	UINT16 csrIndex[NUM_TAGE_TABLES];
+	UINT16 csrTag[2][NUM_TAGE_TABLES];
+	UINT32 PHR;
+	UINT32 histHead;                      //newest bit in the history ring
+} histCkpt_t;
+
+//history one hardware thread keeps to itself while threads share the tables (setThreads()).
+//Its GHR is a ring like the speculative one, so switching threads only points the predictor
+//at another context and never copies history.
+typedef struct threadCtx{
+	bool *hist;                           //ring of SMT_HIST_SIZE history bits
+	UINT32 head;                          //newest bit in hist
+	csr_t *csrIndex;
+	csr_t *csrTag[2];
+	UINT32 PHR;
+	UINT64 scGHR;
+	UINT64 insts;                         //instructions, branches and mispredictions the thread ran
+	UINT64 branches;
+	UINT64 miss;
+} threadCtx_t;
+
+//shadow of a tagged entry for the aliasing analysis, kept outside the tables themselves
+typedef struct aliasVal{
+	UINT32 PC;            //full PC of the branch that allocated the entry
+	UINT64 hist;          //hash of the full history that branch saw
+	bool valid;           //entry has been allocated at least once
+} aliasVal_t;
+
+//tag hit outcomes per table for the aliasing analysis
+typedef struct aliasStat{
+	UINT64 hits;          //provider tag hits
+	UINT64 falsePC;       //hits on an entry allocated by a different branch
+	UINT64 falseCtx;      //hits by the same branch under a different history
+	UINT64 cold;          //hits on an entry that was never allocated
+} aliasStat_t;
+
+//one resolved branch of a trace, for predictBatch()
+typedef struct branchRecord{
+	UINT32 PC;
+	bool resolveDir;
+	UINT32 branchTarget;
+} branchRecord_t;
+
 typedef struct loopVal{
 	UINT32 loopCount;     //loop count?
 	UINT32 currentIter;   //current iteration of the loop
@@ -49,21 +133,90 @@ typedef struct loopVal{
 	bool used;
 } loopVal_t;
 
-class PREDICTOR{
+//an indirect target entry. Targets are stored as the offset inside a region plus the region
+//table entry that holds the rest of the address.
+typedef struct targetVal{
+	UINT16 tag;
+	UINT16 offset;                        //low target bits
+	uint8_t region;                       //region table entry with the high target bits
+	uint8_t ctr;                          //confidence in the target
+	uint8_t u;                            //useful
+} targetVal_t;
+
+//what training an indirect branch needs from its target lookup
+typedef struct targetCtx{
+	UINT32 index[NUM_IT_TABLES];
+	UINT16 tag[NUM_IT_TABLES];
+	UINT32 baseIndex;
+	int provider;                         //target table that hit with the longest history, NUM_IT_TABLES for none
+	UINT32 provTarget;                    //its target (the base table's if none hit)
+	UINT32 altTarget;                     //target of the next hit, or the base table
+	UINT32 target;                        //the prediction
+} targetCtx_t;
+
+//a table write held back by the update delay: the entry's whole new value, and when it lands
+typedef struct pendingWrite{
+	int table;                            //tagged table, NUM_TAGE_TABLES for bimodal, NUM_TAGE_TABLES+1 for loop,
+	                                      //NUM_TAGE_TABLES+2 for a corrector weight, NUM_TAGE_TABLES+3 for the
+	                                      //override fast table, -1 once superseded
+	UINT32 index;
+	UINT64 due;                           //update count at which it lands
+	tagVal_t tagVal;
+	bimodVal_t bimodVal;
+	loopVal_t loopVal;
+	int8_t weight;
+} pendingWrite_t;
+
+//Per-table indices and tags for every branch of a trace. The GHR, PHR and CSRs the hashes
+//read only depend on the branch PCs and resolved directions, never on table contents, so
+//build() hashes a whole trace ahead of time (in parallel chunks that each replay the
+//history leading into them) and PREDICTOR::useStream() then runs the tables over the
+//stream without hashing or folding. A stream can be reused by every predictor run on the
+//same trace, and buildCached() keeps it on disk for runs that only change table contents
+//or counters.
+class INDEX_STREAM{
+public:
+	INDEX_STREAM(void);
+	~INDEX_STREAM(void);
+	void    build(const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads);
+	void    buildCached(const char *file, const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads);
+	bool    load(const char *file, const UINT32 *PCs, const bool *dirs, UINT64 n);
+	bool    save(const char *file);
+
+	UINT64  size() const { return n; }
+	const UINT32 *indexRow(UINT64 branch) const { return &index[branch * NUM_TAGE_TABLES]; }
+	const UINT16 *tagRow(UINT64 branch) const { return &tag[branch * NUM_TAGE_TABLES]; }
+
+private:
+	UINT64 n;                             //branches in the stream
+	UINT64 key;                           //hash of the trace and hashing configuration it was built from
+	UINT32 *index;                        //NUM_TAGE_TABLES indices per branch
+	UINT16 *tag;                          //NUM_TAGE_TABLES tags per branch
+
+	static UINT64 makeKey(const UINT32 *PCs, const bool *dirs, UINT64 n);
+	void    alloc(UINT64 n);
+	void    buildChunk(const UINT32 *PCs, const bool *dirs, UINT64 begin, UINT64 end);
+};
+
+class PREDICTOR : public PREDICTOR_BASE{
 
   // The state is defined for Gshare, change for your design
 
 private:
   	bitset<1001> *GHR;           // global history register
-  	UINT32 PHR; 		   //path history
+	bool historyShared;          //GHR belongs to whoever shareHistory() was called by, which shifts it
+  	UINT32 *PHR; 		   //path history, of the running thread
 	
 	//tables
 	bimodVal_t *bimodal;       //bimodal table
 	UINT32  numBimodalEntries; //number of entries in bimodal table
 	tagVal_t **tagTables;                 //TAGE table
 	//UINT32 tageTableSize;	              //number of entries in TAGE table
-	loopVal_t *loopTable;                 //loop table
+	loopVal_t *loopTable;                 //loop table, if LOOP_WAYS is 1
 	UINT32 loopTableSize;                 //number of loop table entries
+	UINT64 *loopPacked;                   //set-associative loop table of packed entries, if LOOP_WAYS isn't 1
+	char *loopPackedAlloc;                //what was allocated for it before aligning to a cache line
+	UINT32 loopSets;
 
 	UINT32 *tageTableSize;
 	UINT32 *tageTagSize;
@@ -73,12 +226,122 @@ private:
 	csr_t **csrTag;                     //2 circular shift registers for tags
 	 
 	prediction_t pred;                    //global prediction
+	bool loopPred;                        //loop lookup of the last prediction, recorded on update
+	bool loopUsed;
+	int conf;                             //confidence class of the last prediction
+	UINT16 scIndex[NUM_SC_TABLES + 1];    //corrector lookup of the last prediction, recorded on update
+	int scSum;
+	bool tagePred;
 	
  	UINT32 *tageIndex;                    //index calculated for a given table 
 	UINT32 *tageTag;                      //tag calculated for a given table
 	UINT32 clock;                         //global clock
   	bool clockState;                      //clocl flip it
   	INT32 altBetterCount;                 //number of times altpred is better than prd
+	UINT32 allocSeed;                     //own lcg for allocation, instances never share it
+
+	//occupancy snapshots (only touched if SNAPSHOT isn't 0)
+	UINT32 snapBranches;                  //branches seen since the last snapshot
+	UINT32 snapCount;                     //number of snapshots taken
+	UINT32 snapSeed;                      //private sampling seed so allocation's draws are left alone
+	UINT32 *snapHits;                     //provider hits per table since the last snapshot
+	UINT32 *snapAllocs;                   //allocations per table since the last snapshot
+
+	//tag aliasing analysis (only touched if ALIAS isn't 0)
+	aliasVal_t **aliasTables;             //shadow of every tagged entry
+	UINT64 *aliasHist;                    //64 bit fold of each table's full history
+	aliasStat_t *aliasStats;              //hit outcomes per table
+	UINT32 aliasBranches;                 //branches seen since the last report
+
+	//mispredictions per confidence class (only touched if CONF_STATS isn't 0)
+	UINT64 confBranches[NUM_CONF_CLASSES];
+	UINT64 confMiss[NUM_CONF_CLASSES];
+	UINT32 confCount;                     //branches seen since the last report
+
+	//statistical corrector (only touched if SC isn't 0)
+	int8_t *scWeights;                    //NUM_SC_TABLES GEHL tables then the bias table, in one array
+	UINT64 *scGHR;                        //the corrector's own global history, shifted on update
+	INT32 scThreshold;                    //|sum| the corrector needs to override TAGE
+	INT32 scThresholdCtr;                 //moves the threshold when it saturates
+
+	//indirect target prediction (only touched if ITTAGE isn't 0)
+	targetVal_t **itTables;               //tagged target tables, longest history first
+	targetVal_t *itBase;                  //PC indexed targets, tag and u unused
+	UINT32 *itRegions;                    //high target bits of each region
+	UINT32 itRegionNext;                  //region replaced next
+	UINT32 itClock;                       //indirect branches since the u bits were cleared
+	UINT64 itIndirect;                    //indirect branches predicted
+	UINT64 itMiss;                        //wrong targets among them
+	UINT64 insts;                         //instructions seen (only counted if IT_STATS or FRONTEND isn't 0)
+
+	//BTB, return address stack and fetch redirects (only touched if FRONTEND isn't 0)
+	UINT32 *btbTag;                       //BTB_WAYS partial tags per set, 0 for an empty way
+	UINT32 *btbTarget;
+	UINT32 *btbStamp;                     //last use (LRU) or fill (FIFO) of each way
+	UINT32 btbTick;
+	UINT32 btbSeed;                       //own lcg for random replacement, allocSeed drives allocation
+	UINT32 *rasStack;
+	UINT32 rasTop;                        //newest return address
+	UINT32 rasCount;                      //return addresses on the stack
+	UINT64 btbLookups;
+	UINT64 btbHits;
+	UINT64 rasPops;
+	UINT64 rasRight;
+	UINT64 rasOverflow;                   //calls that pushed out the oldest return address
+	UINT64 rasUnderflow;                  //returns with nothing on the stack
+	UINT64 redirects[NUM_REDIRECT_CAUSES];
+
+	//fast bimodal prediction the full one overrides a few cycles later (counted if OVERRIDE isn't 0)
+	bimodVal_t *fastTable;                //its own bimodal table, trained on every branch (NULL unless OVERRIDE)
+	bool fastPred;                        //fast table prediction of the last lookup
+	UINT32 ovBubble;                      //fetch cycles an override throws away
+	UINT32 ovPenalty;                     //cycles a mispredict costs
+	UINT64 ovBranches;
+	UINT64 ovOverrides;                   //full prediction disagreed with the fast one
+	UINT64 ovFixed;                       //overrides that turned a wrong fast prediction right
+	UINT64 ovBroke;                       //overrides that turned a right fast prediction wrong
+	UINT64 fastMiss;
+	UINT64 slowMiss;
+
+	//indices and tags hashed ahead of time by a stream or a batch (NULL to hash live)
+	const UINT32 *rowIndex;
+	const UINT16 *rowTag;
+	UINT64 rowCount;                      //branches with precomputed rows
+	UINT64 rowPos;                        //row of the branch being predicted
+	UINT32 *batchIndex;                   //rows hashed by predictBatch()
+	UINT16 *batchTag;
+	UINT32 batchSize;                     //branches batchIndex and batchTag have room for
+
+	//speculative history (only touched if SPEC_HISTORY isn't 0)
+	bool *specHist;                       //ring of history bits, standing in for the GHR
+	UINT32 specHead;                      //newest bit in specHist
+	histCkpt_t *ckpts;                    //ring of checkpoints, one per branch in flight
+	UINT32 ckptNext;                      //next free checkpoint
+	UINT32 ckpt;                          //checkpoint of the branch being predicted or updated
+
+	//delayed table writes (only touched if the update delay isn't 0)
+	UINT32 updDelay;                      //branches before an update's writes reach the tables
+	UINT64 updBranches;                   //updates so far
+	pendingWrite_t *updQueue;             //ring of writes waiting to land, oldest first. NULL to write in place
+	UINT32 updQueueSize;
+	UINT32 updHead;                       //oldest queued write
+	UINT32 updCount;                      //writes queued
+	UINT32 **updPendingTag;               //1 + queue slot of the write waiting for each entry, 0 if none
+	UINT32 *updPendingBimodal;
+	UINT32 *updPendingLoop;
+	UINT32 *updPendingSC;
+	UINT32 *updPendingFast;
+	tagVal_t *updSavedTag;                //entries train() can change, as lookups see them
+	tagVal_t *updStartTag;                //the same entries with their waiting writes, what train() starts from
+	bimodVal_t updSavedBimodal;
+	loopVal_t updSavedLoop;
+	int8_t updSavedSC[NUM_SC_TABLES + 1];
+	UINT32 prefetchDist;                  //branches ahead whose tagged rows are prefetched
+
+	//hardware threads sharing the tables (only more than one after setThreads())
+	threadCtx_t *threads;                 //thread 0's context holds the constructor's CSRs
+	UINT32 numThreads;
+	UINT32 thread;                        //thread the calls belong to
 public:
 
   	// The interface to the four functions below CAN NOT be changed
@@ -88,19 +351,123 @@ public:
 
   	void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
   	void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget);
+	bool    shareHistory(bitset<1001> *ghr);
   	
 	//void    steal(UINT32 PC, UINT32 table, UINT32 index, UINT32 bimodalIndex, bool predDir);
 
-	UINT32  getTag(UINT32 PC, int table, UINT32 tagSize);
-	UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset);
+	bool    lookup(UINT32 PC, predToken_t *ctx) const;
+	void    scLookup(UINT32 PC, predToken_t *ctx) const;
+	void    scTrain(bool resolveDir);
+	UINT32  getTag(UINT32 PC, int table, UINT32 tagSize) const;
+	UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset) const;
 	void    initFold(csr_t *shift, UINT32 origLen, UINT32 newLen);
 	void    fold(csr_t *shift);
+	void    train(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
+	UINT32  nextTenth();
+	UINT32  loopEntry(UINT32 PC) const;
+	void    loopRead(UINT32 index, loopVal_t *entry) const;
+	void    loopWrite(UINT32 index, const loopVal_t *entry);
+	void    updateHistory(UINT32 PC, bool resolveDir, bool predDir);
+	void    setUpdateDelay(UINT32 delay);
+	void    delayApply(UINT64 upTo);
+	pendingWrite_t *delayWrite(UINT32 *pending, int table, UINT32 index);
+	void    specPush(UINT32 PC, bool dir);
+	void    setThreads(UINT32 count);
+	void    setThread(UINT32 tid);
+	void    threadPush(UINT32 PC, bool dir);
+	void    threadReport();
+	void    useStream(const INDEX_STREAM *stream);
+	void    predictBatch(const branchRecord_t *records, UINT32 n, bool *preds);
+	bool    predict(UINT32 PC, predToken_t *token);
+	void    update(UINT32 PC, bool resolveDir, const predToken_t *token, UINT32 branchTarget);
+	void    setPrefetch(UINT32 distance);
+	void    prefetchBranch(UINT32 PC);
+	void    snapshot();
+	void    reportStorage();
+	void    aliasFold(UINT64 *hist, UINT32 histLen);
+	void    aliasReport();
+	int     confidence() const;
+	void    confReport();
+	UINT32  predictTarget(UINT32 PC, targetCtx_t *ctx) const;
+	void    trainTarget(const targetCtx_t *ctx, UINT32 target);
+	void    setTarget(targetVal_t *entry, UINT32 target, bool right);
+	UINT32  targetRegion(UINT32 target);
+	void    targetReport();
+	bool    btbLookup(UINT32 PC, UINT32 *target);
+	void    btbUpdate(UINT32 PC, UINT32 target);
+	void    rasPush(UINT32 addr);
+	bool    rasPop(UINT32 *addr);
+	void    frontendBranch(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
+	void    frontendOther(UINT32 PC, OpType opType, UINT32 branchTarget, const UINT32 *indirectTarget);
+	void    frontendReport();
+	bool    predictOverride(UINT32 PC, bool *fastDir);
+	void    setOverrideCost(UINT32 bubble, UINT32 penalty);
+	void    overrideBranch(UINT32 PC, bool resolveDir, bool predDir);
+	void    overrideReport();
 
   	// Contestants can define their own functions below
 
+	friend class ::PREDICTOR_BENCH;        //LTAGE-bench.cc plants table state to pick a path
+
 };
 
+//one independent simulation (a predictor and the trace it runs) for runSequential() and
+//runInterleaved()
+typedef struct instance{
+	PREDICTOR *p;
+	const UINT32 *PCs;
+	const bool *dirs;
+	UINT64 n;             //branches in the trace
+	UINT64 miss;          //mispredictions, filled in by the run
+} instance_t;
+
+void    runSequential(instance_t *runs, UINT32 count);
+void    runInterleaved(instance_t *runs, UINT32 count, UINT32 group);
+
+//one hardware thread's trace for runSMT(): its branches, and how many other instructions come
+//before each of them (NULL for none), which count toward its MPKI and SMT_BY_INSTS
+typedef struct smtThread{
+	const UINT32 *PCs;
+	const bool *dirs;
+	const UINT32 *gaps;
+	UINT64 n;             //branches in the trace
+	UINT64 miss;          //mispredictions, filled in by the run
+} smtThread_t;
+
+//how runSMT() interleaves threads
+const int SMT_ROUND_ROBIN = 0;        //switch thread every quantum branches
+const int SMT_BY_INSTS = 1;           //switch thread every quantum instructions
+
+void    runSMT(PREDICTOR *p, smtThread_t *threads, UINT32 count, int policy, UINT32 quantum);
+
+//PC-indexed components replayComponent() can study on their own
+const int STUDY_BIMODAL = 0;
+const int STUDY_LOOP = 1;
+
+//totals of a component study
+typedef struct studyStats{
+	UINT64 branches;      //branches replayed
+	UINT64 predicted;     //branches the component predicted (all of them for bimodal, confident ones for loop)
+	UINT64 miss;          //mispredictions among the predicted ones
+} studyStats_t;
+
+studyStats_t replayComponent(int component, const UINT32 *PCs, const bool *dirs, UINT64 n, UINT32 threads);
+
+//totals of a limit study, the predictor as configured next to the unbounded TAGE oracle
+typedef struct limitStats{
+	UINT64 branches;
+	UINT64 insts;         //instructions the MPKI is over
+	UINT64 realMiss;      //the predictor's mispredictions
+	UINT64 oracleMiss;    //the oracle's mispredictions
+	UINT64 entries;       //tagged, bimodal and loop entries the oracle allocated
+	UINT64 hostBytes;     //what its tables took
+} limitStats_t;
+
+limitStats_t limitStudy(PREDICTOR *p, const char *trace, const UINT32 *PCs, const bool *dirs, UINT64 n,
+                        UINT64 insts, UINT32 histScale);
 
 /***********************************************************/
+} // namespace ltageFinal
+
 #endif
 
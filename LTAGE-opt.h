@@ -1,14 +1,17 @@
-#ifndef _PREDICTOR_H_
-#define _PREDICTOR_H_
+#ifndef _LTAGE_OPT_H_
+#define _LTAGE_OPT_H_
 
 #include "utils.h"
 #include "tracer.h"
+#include "predictorBase.h"
 #include <bitset>
 
-#define NUM_TAGE_TABLES 12
-
 #define UINT16	     unsigned short int
 
+namespace ltageOpt {
+
+const int NUM_TAGE_TABLES = 12;
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 //Circular Shift Register for folding purposes
@@ -48,7 +51,7 @@ typedef struct loopVal{
 	bool used;
 } loopVal_t;
 
-class PREDICTOR{
+class PREDICTOR : public PREDICTOR_BASE{
 
   // The state is defined for Gshare, change for your design
 
@@ -94,6 +97,7 @@ public:
 	UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset);
 	void    initFold(csr_t *shift, UINT32 origLen, UINT32 newLen);
 	void    fold(csr_t *shift);
+	void    reportStorage();
 
   	// Contestants can define their own functions below
 
@@ -101,5 +105,7 @@ public:
 
 
 /***********************************************************/
+} // namespace ltageOpt
+
 #endif
 
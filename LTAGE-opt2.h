@@ -1,14 +1,17 @@
-#ifndef _PREDICTOR_H_
-#define _PREDICTOR_H_
+#ifndef _LTAGE_OPT2_H_
+#define _LTAGE_OPT2_H_
 
 #include "utils.h"
 #include "tracer.h"
+#include "predictorBase.h"
 #include <bitset>
 
-#define NUM_TAGE_TABLES 12
-
 #define UINT16	     unsigned short int
 
+namespace ltageOpt2 {
+
+const int NUM_TAGE_TABLES = 12;
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 //Circular Shift Register for folding purposes
@@ -48,12 +51,13 @@ typedef struct loopVal{
 	bool used;
 } loopVal_t;
 
-class PREDICTOR{
+class PREDICTOR : public PREDICTOR_BASE{
 
   // The state is defined for Gshare, change for your design
 
 private:
   	bitset<1001> *GHR;           // global history register
+	bool historyShared;          //GHR belongs to whoever shareHistory() was called by, which shifts it
   	UINT32 PHR; 		   //path history
 	
 	//tables
@@ -87,6 +91,7 @@ public:
 
   	void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
   	void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget);
+	bool    shareHistory(bitset<1001> *ghr);
   	
 	//void    steal(UINT32 PC, UINT32 table, UINT32 index, UINT32 bimodalIndex, bool predDir);
 
@@ -94,6 +99,7 @@ public:
 	UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset);
 	void    initFold(csr_t *shift, UINT32 origLen, UINT32 newLen);
 	void    fold(csr_t *shift);
+	void    reportStorage();
 
   	// Contestants can define their own functions below
 
@@ -101,5 +107,7 @@ public:
 
 
 /***********************************************************/
+} // namespace ltageOpt2
+
 #endif
 
@@ -1,5 +1,6 @@
-#include "predictor.h"
+#include "PPMpredictor.h"
 #include <fstream>
+#include "storageBudget.h"
 
 #define UINT16      unsigned short int
 
@@ -26,22 +27,37 @@
 #define WEAKLY_NOT_TAKEN 3
 
 #define LOG 1
-/////////////// STORAGE BUDGET JUSTIFICATION ////////////////
-// Total storage budget: 52KB + 32 bits
 
-// Total PHT counters for Global predictor: 2^16
-// Total PHT size for global predictor = 2^16 * 2 bits/counter = 2^17 bits = 16KB
-// GHR size for global predictor: 32 bits
+#define LOCAL 0 //1 to add a local history predictor and a tournament chooser over it and ppm, 0 if you don't
+#define LOCAL_BHT_SIZE 10  //1k branch histories
+#define LOCAL_HIST_LEN 10  //10 outcomes per history
+#define LOCAL_PHT_SIZE 12  //4k local counters, 4 groups of PCs get their own 1k
 
-// Total PHT counters for local predictor: 2^16
-// Total PHT size for local predictor = 2^16 * 2 bits/counter = 2^17 bits = 16KB
-// Total BHT size for local predictor = 2^11 * 16 bits/counter = 2^15 bits = 4KB
-// Total Size for local predictor = 16KB + 4KB = 20KB
+#define STORAGE_BUDGET BUDGET_32KB //32KB class, modelled bits (local predictor included) are checked against it at compile time
+#define STORAGE_REPORT 0 //1 if you want modelled bits and host bytes printed at startup, 0 if you don't
 
-// Total Tournament counters is: 2^16
-// Total Tournament counter's size = 2^16 * 2 bits/counter = 2^17 bits = 16KB
+/////////////// STORAGE BUDGET JUSTIFICATION ////////////////
+// Derived from the configuration by the accountant below and checked against STORAGE_BUDGET.
+// Bimodal table: 2^BIMODAL_SIZE entries of BIMODAL_PRED_SIZE pred bits + 1 meta bit
+// PPM tables: 4 tables of 2^PPM_TABLE_SIZE entries of PPM_PRED_SIZE pred + PPM_TAG_SIZE tag + 1 u bits
+// History: ghr up to the longest history and the folded CSRs
+// Local predictor (if LOCAL is set, checked with the rest): 2^LOCAL_BHT_SIZE entries
+//   of LOCAL_HIST_LEN history + 2 chooser bits, 2^LOCAL_PHT_SIZE 2 bit counters
+// Set STORAGE_REPORT to 1 for the totals and the host bytes they really take
 /////////////////////////////////////////////////////////////
 
+namespace ppm {
+
+//modelled hardware bits of each component
+constexpr UINT64 BIMODAL_BITS = tableBits(BIMODAL_SIZE, BIMODAL_PRED_SIZE + 1);
+constexpr UINT64 PPM_BITS = 4 * tableBits(PPM_TABLE_SIZE, PPM_PRED_SIZE + PPM_TAG_SIZE + 1);
+constexpr UINT64 HISTORY_BITS = (HIST_4 + 1) + 4 * (PPM_TAG_SIZE + (PPM_TAG_SIZE - 1) + PPM_TABLE_SIZE);
+constexpr UINT64 TOTAL_BITS = BIMODAL_BITS + PPM_BITS + HISTORY_BITS;
+static_assert(TOTAL_BITS <= STORAGE_BUDGET, "PPMpredictor is over its storage budget");
+constexpr UINT64 LOCAL_BITS = localBits(LOCAL_BHT_SIZE, LOCAL_HIST_LEN, LOCAL_PHT_SIZE);
+static_assert(LOCAL_HIST_LEN <= LOCAL_MAX_HIST && LOCAL_PHT_SIZE >= 5, "local predictor entries don't fit its packing");
+static_assert(TOTAL_BITS + LOCAL_BITS <= STORAGE_BUDGET, "PPMpredictor is over its storage budget with its local predictor");
+
 void initLog(){
 	if(LOG)
 		std::remove("log.txt");
@@ -114,7 +130,16 @@ PREDICTOR::PREDICTOR(void){
         initFold(&csrIndex[i], ppmHistory[i], PPM_TABLE_SIZE);
   }
   log("init fold");
+  //no prediction yet, update reads index before any table has hit
+  pred.pred = NOT_TAKEN;
+  pred.table = -1;
+  pred.index = 0;
+  local = NULL;
+  if(LOCAL)
+	local = new LOCAL_PREDICTOR(LOCAL_BHT_SIZE, LOCAL_HIST_LEN, LOCAL_PHT_SIZE);
   log("Init Complete");
+  if(STORAGE_REPORT)
+	reportStorage();
   
 }
 
@@ -163,6 +188,8 @@ bool   PREDICTOR::GetPrediction(UINT32 PC){
 	else
 		pred.pred=NOT_TAKEN;
     } 
+    if(LOCAL) //pred keeps the ppm prediction, ppm trains on that
+	return local->choose(PC, pred.pred);
     return pred.pred;
     //log("Done predict");
 
@@ -173,6 +200,10 @@ bool   PREDICTOR::GetPrediction(UINT32 PC){
 void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
  	//log("get update");
 	UINT32 bimodalIndex = (PC) % (1<<BIMODAL_SIZE); //calculate bimodal index before ghr updates	
+	if(LOCAL) {
+		local->update(resolveDir);
+		predDir = pred.pred; //ppm's own prediction, not the chooser's
+	}
 
   	//update the prediction counter for the last prediction
 	//log("update pred pred");
@@ -337,6 +368,23 @@ void PREDICTOR::fold(csr *shift){
 	shift->val &= (1 << shift->newLen) - 1;
 }
 
+//print the modelled bits of each component next to the host bytes it takes
+void PREDICTOR::reportStorage(){
+	UINT64 ppmBytes = 4 * (1<<PPM_TABLE_SIZE) * sizeof(ppmVal_t);
+	UINT64 bimodalBytes = (1<<BIMODAL_SIZE) * sizeof(bimodVal_t);
+	UINT64 historyBytes = sizeof(ghr) + 3 * 4 * sizeof(csr_t);
+	//everything else in the object
+	UINT64 otherBytes = sizeof(*this) - sizeof(ghr);
+	printStorage("bimodal", BIMODAL_BITS, bimodalBytes);
+	printStorage("ppm", PPM_BITS, ppmBytes);
+	printStorage("history", HISTORY_BITS, historyBytes);
+	printStorage("other", 0, otherBytes);
+	printStorage("total", TOTAL_BITS, bimodalBytes + ppmBytes + historyBytes + otherBytes);
+	if(LOCAL) //held to the same budget as the rest
+		printStorage("local", LOCAL_BITS, local->hostBytes());
+	printf("budget   modelled %8u bits = %7.2f KB\n", STORAGE_BUDGET, STORAGE_BUDGET / 8192.0);
+}
+
 void    PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget){
 
   // This function is called for instructions which are not
@@ -349,3 +397,5 @@ void    PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget)
 
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
+
+} // namespace ppm
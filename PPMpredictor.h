@@ -1,12 +1,16 @@
-#ifndef _PREDICTOR_H_
-#define _PREDICTOR_H_
+#ifndef _PPM_PREDICTOR_H_
+#define _PPM_PREDICTOR_H_
 
 #include "utils.h"
 #include "tracer.h"
+#include "predictorBase.h"
+#include "localPredictor.h"
 #include <bitset>
 
 #define UINT16      unsigned short int
 
+namespace ppm {
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 //Circular Shift Register for folding purposes
@@ -33,7 +37,7 @@ typedef struct prediction{
 	UINT32 index; //index in the table that the prediction came from
 } prediction_t;
 
-class PREDICTOR{
+class PREDICTOR : public PREDICTOR_BASE{
 
   // The state is defined for Gshare, change for your design
 
@@ -49,21 +53,9 @@ class PREDICTOR{
   //UINT32* ppmIndex;
   //UINT32* ppmTag;
 
-  //add for local predictor
-  //local pattern history table
-  //UINT32 pht_local_bit_size;
-  UINT32 *pht_local;
-  UINT32 numPhtLocalEntries;
-
-  //branch history table for local branch predictor
-  UINT32 bht_history_length;
-  UINT32 numBhtEntries;
-  UINT32 bht_bit_size;
-  UINT16 *bht;
-
-  //for tournament counter
-  UINT32 *predictorChooseCounter;
-  UINT32 numTournamentCounter;
+  //local predictor: per PC branch history table, local pattern history table and the
+  //tournament chooser between it and the ppm prediction, only allocated if LOCAL is set
+  LOCAL_PREDICTOR *local;
 
   bimodVal_t *bimodalTable;
   ppmVal_t *ppmTables[4];
@@ -89,10 +81,6 @@ class PREDICTOR{
   PREDICTOR(void);
   bool    GetPrediction(UINT32 PC);
 
-  //add for tournament predictor
-  //bool    GetLocalPrediction(UINT32 PC);
-  //bool    GetGlobalPrediction(UINT32 PC);
-
   void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
   void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget);
   
@@ -102,6 +90,7 @@ class PREDICTOR{
   UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize);
   void    initFold(csr_t *shift, UINT32 origLen, UINT32 newLen);
   void    fold(csr_t *shift);
+  void    reportStorage();
 
   // Contestants can define their own functions below
 
@@ -109,5 +98,7 @@ class PREDICTOR{
 
 
 /***********************************************************/
+} // namespace ppm
+
 #endif
 
@@ -0,0 +1,281 @@
+#include "PerceptronPredictor.h"
+#include <cstdlib>
+#include "storageBudget.h"
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define PERC_WEIGHT_MAX   127 //8 bit weights, kept in -127..127 so negating one can't overflow
+#define PERC_THETA_INIT   373 //1.93 * history bits + 14, the usual perceptron threshold
+#define PERC_THETA_BITS   12  //bits of the threshold
+#define PERC_TC_MAX       63  //7 bit signed counter that moves the threshold
+#define PERC_ROW_HIST     0   //newest history bits hashed into the rows of every table but the first, 0 for PC only.
+                              //A row already dots its whole segment, so splitting rows by history only dilutes
+                              //their training: 4 to 24 bits (of the newest or of each table's own segment) lost
+                              //to PC only rows on random, mixed local/global and 512 to 16K block CFG traces.
+
+#define STORAGE_BUDGET    BUDGET_32KB //32KB class, modelled bits are checked against it at compile time
+#define STORAGE_REPORT    0   //1 if you want modelled bits and host bytes printed at startup, 0 if you don't
+
+/////////////// STORAGE BUDGET JUSTIFICATION ////////////////////////////////
+// Derived from the configuration by the accountant below and checked against STORAGE_BUDGET:
+// Weight tables: table i has 2^PERC_ROW_LOG[i] rows of PERC_ROW_WEIGHTS 8 bit weights
+// History: NUM_PERC_TABLES segments of PERC_SEG_BITS, the threshold and its counter
+// Set STORAGE_REPORT to 1 for the totals and the host bytes they really take
+/////////////////////////////////////////////////////////////////////////////
+
+namespace perceptron {
+
+//log2 rows of each table, newest history segment first
+constexpr UINT32 PERC_ROW_LOG[NUM_PERC_TABLES] = {8, 8, 8, 7, 6, 5};
+
+//modelled hardware bits of each component
+constexpr UINT64 WEIGHT_BITS = tablesBits(PERC_ROW_LOG, PERC_ROW_WEIGHTS * 8, NUM_PERC_TABLES);
+constexpr UINT64 HISTORY_BITS = NUM_PERC_TABLES * PERC_SEG_BITS +           //global history
+                                PERC_THETA_BITS + bitsFor(PERC_TC_MAX) + 1; //threshold and counter
+constexpr UINT64 TOTAL_BITS = WEIGHT_BITS + HISTORY_BITS;
+static_assert(TOTAL_BITS <= STORAGE_BUDGET, "PerceptronPredictor is over its storage budget");
+static_assert(PERC_ROW_WEIGHTS == 32, "a row is one 256 bit vector");
+static_assert(PERC_ROW_HIST <= PERC_SEG_BITS, "row hashes only see the newest segment");
+
+//fold history bits into rowLog bits
+static inline UINT32 foldRow(UINT32 h, UINT32 rowLog) {
+	UINT32 folded = 0;
+	for(; h; h >>= rowLog)
+		folded ^= h;
+	return folded & ((1 << rowLog) - 1);
+}
+
+#if defined(__AVX2__)
+//+1 in byte k if bit k of bits is set, -1 if it isn't
+static inline __m256i signLanes(UINT32 bits) {
+	const __m256i byteOf = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+	                                        2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i bitOf = _mm256_set1_epi64x(0x8040201008040201LL);
+	__m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(bits), byteOf);
+	__m256i clear = _mm256_cmpeq_epi8(_mm256_and_si256(v, bitOf), _mm256_setzero_si256());
+	return _mm256_or_si256(clear, _mm256_set1_epi8(1));
+}
+
+//sum over every table of its row dotted with its segment
+static inline int dotRows(int8_t *const *rows, const UINT32 *bits) {
+	const __m256i ones = _mm256_set1_epi8(1);
+	__m256i acc = _mm256_setzero_si256();
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		__m256i w = _mm256_loadu_si256((const __m256i *)rows[i]);
+		__m256i prod = _mm256_sign_epi8(w, signLanes(bits[i]));
+		acc = _mm256_add_epi16(acc, _mm256_maddubs_epi16(ones, prod)); //pairs of products as int16
+	}
+	acc = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	s = _mm_hadd_epi32(s, s);
+	s = _mm_hadd_epi32(s, s);
+	return _mm_cvtsi128_si32(s);
+}
+
+//move every weight of a row towards the outcome times its history bit
+static inline void trainRow(int8_t *row, UINT32 bits, bool taken) {
+	__m256i w = _mm256_loadu_si256((const __m256i *)row);
+	__m256i x = signLanes(bits);
+	w = taken ? _mm256_adds_epi8(w, x) : _mm256_subs_epi8(w, x);
+	w = _mm256_max_epi8(w, _mm256_set1_epi8(-PERC_WEIGHT_MAX));
+	_mm256_storeu_si256((__m256i *)row, w);
+}
+#elif defined(__SSE4_1__)
+//signLanes for half a row, bits 16*half up
+static inline __m128i signLanes(UINT32 bits, int half) {
+	const __m128i byteOf = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i bitOf = _mm_set1_epi64x(0x8040201008040201LL);
+	__m128i v = _mm_shuffle_epi8(_mm_cvtsi32_si128(bits >> (16 * half)), byteOf);
+	__m128i clear = _mm_cmpeq_epi8(_mm_and_si128(v, bitOf), _mm_setzero_si128());
+	return _mm_or_si128(clear, _mm_set1_epi8(1));
+}
+
+static inline int dotRows(int8_t *const *rows, const UINT32 *bits) {
+	const __m128i ones = _mm_set1_epi8(1);
+	__m128i acc = _mm_setzero_si128();
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		for(int half = 0; half < 2; half++) {
+			__m128i w = _mm_loadu_si128((const __m128i *)(rows[i] + 16 * half));
+			__m128i prod = _mm_sign_epi8(w, signLanes(bits[i], half));
+			acc = _mm_add_epi16(acc, _mm_maddubs_epi16(ones, prod));
+		}
+	}
+	acc = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+	acc = _mm_hadd_epi32(acc, acc);
+	acc = _mm_hadd_epi32(acc, acc);
+	return _mm_cvtsi128_si32(acc);
+}
+
+static inline void trainRow(int8_t *row, UINT32 bits, bool taken) {
+	for(int half = 0; half < 2; half++) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(row + 16 * half));
+		__m128i x = signLanes(bits, half);
+		w = taken ? _mm_adds_epi8(w, x) : _mm_subs_epi8(w, x);
+		w = _mm_max_epi8(w, _mm_set1_epi8(-PERC_WEIGHT_MAX));
+		_mm_storeu_si128((__m128i *)(row + 16 * half), w);
+	}
+}
+#elif defined(__SSE2__)
+//every x86-64 build: no byte shuffle, sign, maddubs or byte max, so lanes are masked, negated
+//and widened by hand. 0xff in byte k of the result if bit 16*half+k of bits is clear.
+static inline __m128i clearLanes(UINT32 bits, int half) {
+	const __m128i bitOf = _mm_set1_epi64x(0x8040201008040201LL);
+	UINT32 b = bits >> (16 * half);
+	__m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(b & 0xff)), _mm_set1_epi8((char)((b >> 8) & 0xff)));
+	return _mm_cmpeq_epi8(_mm_and_si128(v, bitOf), _mm_setzero_si128());
+}
+
+static inline int dotRows(int8_t *const *rows, const UINT32 *bits) {
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i acc = _mm_setzero_si128();
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		for(int half = 0; half < 2; half++) {
+			__m128i w = _mm_loadu_si128((const __m128i *)(rows[i] + 16 * half));
+			__m128i clear = clearLanes(bits[i], half);
+			__m128i prod = _mm_sub_epi8(_mm_xor_si128(w, clear), clear); //-w where the bit is clear
+			__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(prod, prod), 8);
+			__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(prod, prod), 8);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_add_epi16(lo, hi), ones));
+		}
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+	return _mm_cvtsi128_si32(acc);
+}
+
+static inline void trainRow(int8_t *row, UINT32 bits, bool taken) {
+	const __m128i floor = _mm_set1_epi8(-PERC_WEIGHT_MAX - 1);
+	for(int half = 0; half < 2; half++) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(row + 16 * half));
+		__m128i x = _mm_or_si128(clearLanes(bits, half), _mm_set1_epi8(1));
+		w = taken ? _mm_adds_epi8(w, x) : _mm_subs_epi8(w, x);
+		w = _mm_sub_epi8(w, _mm_cmpeq_epi8(w, floor)); //-128 back up to -PERC_WEIGHT_MAX
+		_mm_storeu_si128((__m128i *)(row + 16 * half), w);
+	}
+}
+#else
+//branch free, so the compiler can vectorise these with whatever the target has
+static inline int dotRows(int8_t *const *rows, const UINT32 *bits) {
+	int sum = 0;
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		for(int k = 0; k < PERC_ROW_WEIGHTS; k++) {
+			int x = (int)((bits[i] >> k) & 1) * 2 - 1;
+			sum += x * rows[i][k];
+		}
+	}
+	return sum;
+}
+
+static inline void trainRow(int8_t *row, UINT32 bits, bool taken) {
+	UINT32 toward = taken ? bits : ~bits; //bits whose weight moves up
+	for(int k = 0; k < PERC_ROW_WEIGHTS; k++) {
+		int w = row[k] + (int)((toward >> k) & 1) * 2 - 1;
+		w = (w > PERC_WEIGHT_MAX) ? PERC_WEIGHT_MAX : w;
+		row[k] = (int8_t)((w < -PERC_WEIGHT_MAX) ? -PERC_WEIGHT_MAX : w);
+	}
+}
+#endif
+
+PREDICTOR::PREDICTOR(void)
+{
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		UINT32 tableSize = (1 << PERC_ROW_LOG[i]) * PERC_ROW_WEIGHTS;
+		weights[i] = new int8_t[tableSize];
+		for(UINT32 j = 0; j < tableSize; j++) {
+			weights[i][j] = 0;
+		}
+		hist[i] = 0;
+		rowIndex[i] = 0;
+		rowBits[i] = 1;
+	}
+	sum = 0;
+	theta = PERC_THETA_INIT;
+	thetaCtr = 0;
+	if(STORAGE_REPORT)
+		reportStorage();
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+bool   PREDICTOR::GetPrediction(UINT32 PC){
+	int8_t *rows[NUM_PERC_TABLES];
+	UINT32 ctx = hist[0] & ((1u << PERC_ROW_HIST) - 1); //picks the row along with the PC
+	for(int i = 0; i < NUM_PERC_TABLES; i++) {
+		UINT32 rowLog = PERC_ROW_LOG[i];
+		rowIndex[i] = (PC ^ (PC >> rowLog) ^ (i ? foldRow(ctx, rowLog) : 0)) & ((1 << rowLog) - 1);
+		rowBits[i] = (hist[i] << 1) | 1; //bias weight always counts as taken
+		rows[i] = &weights[i][rowIndex[i] * PERC_ROW_WEIGHTS];
+	}
+	sum = dotRows(rows, rowBits);
+	return (sum >= 0);
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+void  PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
+	bool percPred = (sum >= 0);
+	//adapt theta so mispredictions and low-sum trainings happen about as often
+	if(percPred != resolveDir) {
+		if(++thetaCtr == PERC_TC_MAX) {
+			thetaCtr = 0;
+			if(theta < (1 << PERC_THETA_BITS) - 1)
+				++theta;
+		}
+	} else if(abs(sum) <= theta) {
+		if(--thetaCtr == -PERC_TC_MAX - 1) {
+			thetaCtr = 0;
+			if(theta > 0)
+				--theta;
+		}
+	}
+	//train on a misprediction or when the sum wasn't past theta
+	if(percPred != resolveDir || abs(sum) <= theta) {
+		for(int i = 0; i < NUM_PERC_TABLES; i++) {
+			trainRow(&weights[i][rowIndex[i] * PERC_ROW_WEIGHTS], rowBits[i], resolveDir);
+		}
+	}
+	updateHistory(resolveDir);
+}
+
+//shift the branch into the newest segment, each segment's oldest bit into the next one
+void PREDICTOR::updateHistory(bool resolveDir){
+	const UINT32 segMask = (1u << PERC_SEG_BITS) - 1;
+	for(int i = NUM_PERC_TABLES - 1; i > 0; i--) {
+		hist[i] = ((hist[i] << 1) | (hist[i-1] >> (PERC_SEG_BITS - 1))) & segMask;
+	}
+	hist[0] = ((hist[0] << 1) | resolveDir) & segMask;
+}
+
+//print the modelled bits of each component next to the host bytes it takes
+void PREDICTOR::reportStorage(){
+	UINT64 weightBytes = 0;
+	for(int i = 0; i < NUM_PERC_TABLES; i++)
+		weightBytes += (1 << PERC_ROW_LOG[i]) * PERC_ROW_WEIGHTS * sizeof(int8_t);
+	UINT64 historyBytes = sizeof(hist) + 2 * sizeof(INT32);
+	//everything else in the object, the row pointers and the last prediction's rows and sum
+	UINT64 otherBytes = sizeof(*this) - historyBytes;
+	printStorage("weights", WEIGHT_BITS, weightBytes);
+	printStorage("history", HISTORY_BITS, historyBytes);
+	printStorage("other", 0, otherBytes);
+	printStorage("total", TOTAL_BITS, weightBytes + historyBytes + otherBytes);
+	printf("budget   modelled %8u bits = %7.2f KB\n", STORAGE_BUDGET, STORAGE_BUDGET / 8192.0);
+}
+
+void    PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget){
+
+  // This function is called for instructions which are not
+  // conditional branches, just in case someone decides to design
+  // a predictor that uses information from such instructions.
+  // We expect most contestants to leave this function untouched.
+
+  return;
+}
+
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+} // namespace perceptron
@@ -0,0 +1,55 @@
+#ifndef _PERCEPTRON_PREDICTOR_H_
+#define _PERCEPTRON_PREDICTOR_H_
+
+#include "utils.h"
+#include "tracer.h"
+#include "predictorBase.h"
+#include <cstdint>
+
+namespace perceptron {
+
+const int NUM_PERC_TABLES = 6;
+const int PERC_ROW_WEIGHTS = 32;      //weights in a row: a bias and one per history bit of the table's segment
+const int PERC_SEG_BITS = PERC_ROW_WEIGHTS - 1;
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+//Hashed multi-table perceptron. Global history is split into NUM_PERC_TABLES segments of
+//PERC_SEG_BITS bits, newest first. Table i picks a row of int8 weights with a hash of the PC
+//(and optionally the newest history bits) and dots it with its segment (taken +1, not taken
+//-1, plus a bias weight). The prediction is the sign of the sum over every table. A row is
+//one 256 bit vector, so the dot product and training are done with AVX2, SSE4.1 or,
+//on any x86-64 build, SSE2. Other targets get a plain loop.
+class PREDICTOR : public PREDICTOR_BASE{
+
+private:
+	UINT32 hist[NUM_PERC_TABLES];         //global history, PERC_SEG_BITS per segment, newest in bit 0 of hist[0]
+	int8_t *weights[NUM_PERC_TABLES];     //rows of PERC_ROW_WEIGHTS weights per table
+	UINT32 rowIndex[NUM_PERC_TABLES];     //row of each table picked for the last prediction
+	UINT32 rowBits[NUM_PERC_TABLES];      //segment each row was dotted with, bias in bit 0
+	INT32 sum;                            //sum of the last prediction
+	INT32 theta;                          //training threshold on |sum|
+	INT32 thetaCtr;                       //moves theta when it saturates
+
+public:
+
+  	// The interface to the four functions below CAN NOT be changed
+
+  	PREDICTOR(void);
+  	bool    GetPrediction(UINT32 PC);
+
+  	void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
+  	void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget);
+
+	void    updateHistory(bool resolveDir);
+	void    reportStorage();
+
+  	// Contestants can define their own functions below
+
+};
+
+
+/***********************************************************/
+} // namespace perceptron
+
+#endif
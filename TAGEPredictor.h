@@ -1,14 +1,17 @@
-#ifndef _PREDICTOR_H_
-#define _PREDICTOR_H_
+#ifndef _TAGE_PREDICTOR_H_
+#define _TAGE_PREDICTOR_H_
 
 #include "utils.h"
 #include "tracer.h"
+#include "predictorBase.h"
 #include <bitset>
 
-#define NUM_TAGE_TABLES 4
-
 #define UINT16	     unsigned short int
 
+namespace tage {
+
+const int NUM_TAGE_TABLES = 4;
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 //Circular Shift Register for folding purposes
@@ -38,7 +41,7 @@ typedef struct prediction{
 	UINT32 altIndex;
 } prediction_t;
 
-class PREDICTOR{
+class PREDICTOR : public PREDICTOR_BASE{
 
   // The state is defined for Gshare, change for your design
 
@@ -78,6 +81,7 @@ public:
 	UINT32  getIndex(UINT32 PC, int table, UINT32 tagSize, UINT32 phrOffset);
 	void    initFold(csr_t *shift, UINT32 origLen, UINT32 newLen);
 	void    fold(csr_t *shift);
+	void    reportStorage();
 
   	// Contestants can define their own functions below
 
@@ -85,5 +89,7 @@ public:
 
 
 /***********************************************************/
+} // namespace tage
+
 #endif
 
@@ -0,0 +1,190 @@
+#include "hybridPredictor.h"
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include "storageBudget.h"
+
+#define HYBRID_CHOOSER_LOG 12 //2^12 chooser entries
+#define HYBRID_HIST_LEN    12 //global history bits hashed into the chooser index for HYBRID_BY_HISTORY
+#define HYBRID_STATS       0  //1 if you want each component's share and accuracy in hybrid.txt, 0 if you don't
+#define HYBRID_INTERVAL    (1<<22) //branches between hybrid reports
+
+/////////////// STORAGE BUDGET JUSTIFICATION ////////////////////////////////
+// On top of the components' own budgets:
+// Chooser: 2^HYBRID_CHOOSER_LOG entries of a 2 bit counter per component
+// History: HYBRID_HIST_LEN bits of global history for HYBRID_BY_HISTORY. The shared GHR
+//   replaces the components' own, so it's left in their budgets
+/////////////////////////////////////////////////////////////////////////////
+
+static_assert(HYBRID_HIST_LEN <= 64, "the chooser's history is 64 bits");
+static_assert(HYBRID_MAX_COMPONENTS * 2 <= 8, "a chooser entry is one byte");
+
+//modelled hardware bits of the chooser and its history
+constexpr UINT64 hybridBits(UINT32 count){
+	return tableBits(HYBRID_CHOOSER_LOG, 2 * count) + HYBRID_HIST_LEN;
+}
+
+//counter of component k in a chooser entry
+static inline UINT32 chooserCtr(uint8_t entry, UINT32 k) {
+	return (entry >> (2 * k)) & 3;
+}
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+
+//run count (2 or 3) components, which stay owned by the caller. Every chooser entry starts
+//weakly on the first component.
+HYBRID_PREDICTOR::HYBRID_PREDICTOR(PREDICTOR_BASE **components, UINT32 count, int indexBy){
+	if(count < 2 || count > HYBRID_MAX_COMPONENTS) {
+		fprintf(stderr, "a hybrid runs 2 to %u components, not %u\n", HYBRID_MAX_COMPONENTS, count);
+		exit(1);
+	}
+	this->count = count;
+	this->indexBy = indexBy;
+	uint8_t init = 2;
+	for(UINT32 k = 0; k < count; k++) {
+		this->components[k] = components[k];
+		preds[k] = false;
+		chosen[k] = 0;
+		compMiss[k] = 0;
+		onlyRight[k] = 0;
+		chosenMiss[k] = 0;
+		if(k > 0)
+			init |= 1 << (2 * k);
+	}
+	chooser = new uint8_t[1 << HYBRID_CHOOSER_LOG];
+	for(UINT32 i = 0; i < (1u << HYBRID_CHOOSER_LOG); i++) {
+		chooser[i] = init;
+	}
+	//one GHR for every component that can read it
+	sharedGHR = new std::bitset<1001>;
+	sharedGHR->reset();
+	UINT32 sharers = 0;
+	for(UINT32 k = 0; k < count; k++) {
+		if(this->components[k]->shareHistory(sharedGHR))
+			++sharers;
+	}
+	if(sharers == 0) {
+		delete sharedGHR;
+		sharedGHR = NULL;
+	}
+	GHR = 0;
+	chooserIndex = 0;
+	choice = 0;
+	branches = 0;
+	miss = 0;
+	allMiss = 0;
+}
+
+HYBRID_PREDICTOR::~HYBRID_PREDICTOR(){
+	delete[] chooser;
+	delete sharedGHR;
+}
+
+//every component predicts, the chooser picks whose prediction to return
+bool HYBRID_PREDICTOR::GetPrediction(UINT32 PC){
+	for(UINT32 k = 0; k < count; k++) {
+		preds[k] = components[k]->GetPrediction(PC);
+	}
+	UINT32 index = PC;
+	if(indexBy == HYBRID_BY_HISTORY)
+		index ^= (UINT32)(GHR & ((1ULL << HYBRID_HIST_LEN) - 1));
+	chooserIndex = (index ^ (index >> HYBRID_CHOOSER_LOG)) & ((1 << HYBRID_CHOOSER_LOG) - 1);
+	uint8_t entry = chooser[chooserIndex];
+	choice = 0;
+	for(UINT32 k = 1; k < count; k++) {
+		if(chooserCtr(entry, k) > chooserCtr(entry, choice))
+			choice = k;
+	}
+	return preds[choice];
+}
+
+//shift the shared history, every component trains on its own prediction, then the chooser
+//moves toward the ones that were right if they disagreed
+void HYBRID_PREDICTOR::UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget){
+	if(sharedGHR) {
+		*sharedGHR <<= 1;
+		if(resolveDir)
+			sharedGHR->set(0, 1);
+	}
+	bool agree = true;
+	for(UINT32 k = 0; k < count; k++) {
+		components[k]->UpdatePredictor(PC, resolveDir, preds[k], branchTarget);
+		if(preds[k] != preds[0])
+			agree = false;
+	}
+	if(!agree) {
+		uint8_t entry = chooser[chooserIndex];
+		for(UINT32 k = 0; k < count; k++) {
+			UINT32 ctr = chooserCtr(entry, k);
+			if(preds[k] == resolveDir && ctr < 3)
+				entry += 1 << (2 * k);
+			else if(preds[k] != resolveDir && ctr > 0)
+				entry -= 1 << (2 * k);
+		}
+		chooser[chooserIndex] = entry;
+	}
+	if(indexBy == HYBRID_BY_HISTORY)
+		GHR = (GHR << 1) | resolveDir;
+
+	if(HYBRID_STATS) {
+		++branches;
+		++chosen[choice];
+		if(predDir != resolveDir)
+			++miss;
+		if(preds[choice] != resolveDir)
+			++chosenMiss[choice];
+		UINT32 right = 0, last = 0;
+		for(UINT32 k = 0; k < count; k++) {
+			if(preds[k] != resolveDir) {
+				++compMiss[k];
+			} else {
+				++right;
+				last = k;
+			}
+		}
+		if(right == 0)
+			++allMiss;
+		else if(right == 1)
+			++onlyRight[last];
+		if(branches % HYBRID_INTERVAL == 0)
+			hybridReport();
+	}
+}
+
+void HYBRID_PREDICTOR::TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget){
+	for(UINT32 k = 0; k < count; k++) {
+		components[k]->TrackOtherInst(PC, opType, branchTarget);
+	}
+}
+
+//component the last prediction came from
+UINT32 HYBRID_PREDICTOR::lastChoice() const {
+	return choice;
+}
+
+//component k's last prediction
+bool HYBRID_PREDICTOR::componentPrediction(UINT32 k) const {
+	return preds[k];
+}
+
+//write the hybrid's mispredictions, then per component how often it was picked, its own
+//mispredictions, how often it was the only one right, and its mispredictions when picked,
+//to hybrid.txt. allMiss are the mispredictions no chooser could have avoided.
+void HYBRID_PREDICTOR::hybridReport(){
+	std::ofstream out;
+	out.open("hybrid.txt", std::ios::app);
+	out<<"branches "<<branches<<" miss "<<miss<<" allMiss "<<allMiss<<std::endl;
+	for(UINT32 k = 0; k < count; k++) {
+		out<<"component "<<k<<" chosen "<<chosen[k]<<" miss "<<compMiss[k]<<" onlyRight "<<onlyRight[k];
+		out<<" chosenMiss "<<chosenMiss[k]<<std::endl;
+	}
+	out<<std::endl;
+}
+
+//print the chooser's modelled bits next to the host bytes it and the shared GHR take, the
+//components report their own
+void HYBRID_PREDICTOR::reportStorage(){
+	UINT64 sharedBytes = sharedGHR ? sizeof(*sharedGHR) : 0;
+	printStorage("chooser", hybridBits(count), (1 << HYBRID_CHOOSER_LOG) * sizeof(uint8_t) + sizeof(*this) + sharedBytes);
+}
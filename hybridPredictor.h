@@ -0,0 +1,68 @@
+#ifndef _HYBRID_PREDICTOR_H_
+#define _HYBRID_PREDICTOR_H_
+
+#include "utils.h"
+#include "tracer.h"
+#include "predictorBase.h"
+#include <cstdint>
+#include <bitset>
+
+const UINT32 HYBRID_MAX_COMPONENTS = 3;
+
+//what the chooser table is indexed with
+const int HYBRID_BY_PC = 0;
+const int HYBRID_BY_HISTORY = 1;      //PC xor the newest global history bits, gshare style
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+//Tournament of two or three variants (any PREDICTOR_BASE, e.g. a ppm::PREDICTOR and a
+//ltageFinal::PREDICTOR) run side by side on one branch stream. Each call is made once here and
+//handed to every component, which then predicts and trains as it would alone, on the
+//prediction it made itself. A chooser entry holds a 2 bit counter per component. When the
+//components disagree, the counters of the ones that were right go up and the others go down,
+//and the component with the highest counter (the first one on a tie) gives the prediction.
+//
+//Components that take a shared history (shareHistory(), e.g. ltageFinal and ltageOpt2, which
+//both keep a 1001 bit GHR) all read one buffer, shifted here once per branch. The rest keep
+//theirs in their own formats (shorter bitsets, segments, rings). The buffer goes with the
+//hybrid, so the components that took it can't run on after it's destroyed.
+class HYBRID_PREDICTOR : public PREDICTOR_BASE{
+
+private:
+	PREDICTOR_BASE *components[HYBRID_MAX_COMPONENTS];
+	UINT32 count;
+	int indexBy;                          //HYBRID_BY_PC or HYBRID_BY_HISTORY
+	uint8_t *chooser;                     //2 bit counter per component, component k in bits 2k and 2k+1
+	UINT64 GHR;                           //global history for HYBRID_BY_HISTORY, newest in bit 0
+	std::bitset<1001> *sharedGHR;         //history read by every component that shares it (NULL if none does)
+	UINT32 chooserIndex;                  //entry the last prediction read
+	bool preds[HYBRID_MAX_COMPONENTS];    //each component's last prediction
+	UINT32 choice;                        //component the last prediction came from
+
+	//per component: predictions it gave, mispredictions, times it was the only one right,
+	//mispredictions among the ones it gave
+	UINT64 branches;
+	UINT64 miss;
+	UINT64 chosen[HYBRID_MAX_COMPONENTS];
+	UINT64 compMiss[HYBRID_MAX_COMPONENTS];
+	UINT64 onlyRight[HYBRID_MAX_COMPONENTS];
+	UINT64 chosenMiss[HYBRID_MAX_COMPONENTS];
+	UINT64 allMiss;                       //every component was wrong
+
+public:
+
+	HYBRID_PREDICTOR(PREDICTOR_BASE **components, UINT32 count, int indexBy);
+	~HYBRID_PREDICTOR();
+
+  	bool    GetPrediction(UINT32 PC);
+  	void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget);
+  	void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget);
+
+	UINT32  lastChoice() const;
+	bool    componentPrediction(UINT32 k) const;
+	void    hybridReport();
+	void    reportStorage();
+};
+
+/***********************************************************/
+#endif
@@ -0,0 +1,125 @@
+#ifndef _LOCAL_PREDICTOR_H_
+#define _LOCAL_PREDICTOR_H_
+
+#include "utils.h"
+#include "storageBudget.h"
+#include <cstdint>
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+//Local-history side predictor with a tournament chooser, for any variant to put next to its
+//global tables. A PC's branch history table (BHT) entry packs its last histLen outcomes and
+//its 2 bit chooser counter into 16 bits. The pattern history table (PHT) packs 2 bit counters
+//32 to a 64 bit word. Both tables are 64 byte aligned, so no entry straddles a cache line and
+//a lookup reads one line of each, where separate history, chooser and counter arrays read three.
+//
+//The variant calls choose(PC, globalPred) for the final direction, then update(resolveDir)
+//when that branch resolves.
+
+const UINT32 LOCAL_CTR_BITS = 2;
+const UINT32 LOCAL_CHOOSER_BITS = 2;
+const UINT32 LOCAL_MAX_HIST = 16 - LOCAL_CHOOSER_BITS;
+const UINT32 LOCAL_LINE_BYTES = 64;
+
+//modelled bits of a local component: BHT entries of history and chooser, PHT counters
+constexpr UINT64 localBits(UINT32 bhtLog, UINT32 histLen, UINT32 phtLog){
+	return tableBits(bhtLog, histLen + LOCAL_CHOOSER_BITS) + tableBits(phtLog, LOCAL_CTR_BITS);
+}
+
+class LOCAL_PREDICTOR{
+
+private:
+	UINT32 bhtLog;
+	UINT32 histLen;                //up to LOCAL_MAX_HIST
+	UINT32 phtLog;                 //at least 5, a full word of counters
+	uint16_t *bht;                 //history in the low histLen bits, chooser in the top 2
+	UINT64 *pht;                   //2 bit counters, 32 per word
+	char *bhtAlloc;                //what was allocated for each table before aligning
+	char *phtAlloc;
+	UINT32 bhtIndex;               //entries the last lookup read
+	UINT32 phtIndex;
+	bool localPred;                //the last lookup's local and global directions
+	bool globalPred;
+
+	//bytes aligned to a cache line, raw gets what to delete
+	static void *alignedAlloc(UINT64 bytes, char **raw){
+		*raw = new char[bytes + LOCAL_LINE_BYTES - 1];
+		return (void *)(((uintptr_t)*raw + LOCAL_LINE_BYTES - 1) & ~(uintptr_t)(LOCAL_LINE_BYTES - 1));
+	}
+
+	UINT32 phtCtr(UINT32 index) const {
+		return (pht[index >> 5] >> ((index & 31) * 2)) & 3;
+	}
+
+public:
+
+	LOCAL_PREDICTOR(UINT32 bhtLog, UINT32 histLen, UINT32 phtLog){
+		this->bhtLog = bhtLog;
+		this->histLen = histLen;
+		this->phtLog = phtLog;
+		//histories start empty with the chooser weakly on the global side, counters weakly not taken
+		bht = (uint16_t *)alignedAlloc((1 << bhtLog) * sizeof(uint16_t), &bhtAlloc);
+		for(UINT32 i = 0; i < (1u << bhtLog); i++) {
+			bht[i] = 1 << LOCAL_MAX_HIST;
+		}
+		pht = (UINT64 *)alignedAlloc((1 << (phtLog - 5)) * sizeof(UINT64), &phtAlloc);
+		for(UINT32 i = 0; i < (1u << (phtLog - 5)); i++) {
+			pht[i] = 0x5555555555555555ULL;
+		}
+		bhtIndex = 0;
+		phtIndex = 0;
+		localPred = false;
+		globalPred = false;
+	}
+
+	~LOCAL_PREDICTOR(){
+		delete[] bhtAlloc;
+		delete[] phtAlloc;
+	}
+
+	//the direction of whichever of the local and the global prediction PC's chooser trusts
+	bool choose(UINT32 PC, bool globalPred){
+		bhtIndex = PC & ((1 << bhtLog) - 1);
+		UINT32 entry = bht[bhtIndex];
+		UINT32 history = entry & ((1 << histLen) - 1);
+		//PC bits above the history give each group of PCs its own counters once phtLog > histLen
+		phtIndex = (history ^ (PC << histLen)) & ((1 << phtLog) - 1);
+		localPred = phtCtr(phtIndex) >= 2;
+		this->globalPred = globalPred;
+		return (entry >> LOCAL_MAX_HIST) >= 2 ? localPred : globalPred;
+	}
+
+	//the local direction of the last lookup
+	bool local() const {
+		return localPred;
+	}
+
+	//train the entries the last choose() read
+	void update(bool resolveDir){
+		UINT32 ctr = phtCtr(phtIndex);
+		UINT32 shift = (phtIndex & 31) * 2;
+		if(resolveDir && ctr < 3)
+			pht[phtIndex >> 5] += (UINT64)1 << shift;
+		else if(!resolveDir && ctr > 0)
+			pht[phtIndex >> 5] -= (UINT64)1 << shift;
+
+		UINT32 entry = bht[bhtIndex];
+		UINT32 chooser = entry >> LOCAL_MAX_HIST;
+		if(localPred != globalPred) { //the chooser moves toward whichever was right
+			if(localPred == resolveDir && chooser < 3)
+				++chooser;
+			else if(globalPred == resolveDir && chooser > 0)
+				--chooser;
+		}
+		UINT32 history = ((entry << 1) | resolveDir) & ((1 << histLen) - 1);
+		bht[bhtIndex] = (uint16_t)((chooser << LOCAL_MAX_HIST) | history);
+	}
+
+	//bytes the host allocates for the tables
+	UINT64 hostBytes() const {
+		return (1 << bhtLog) * sizeof(uint16_t) + (1 << (phtLog - 5)) * sizeof(UINT64) + 2 * (LOCAL_LINE_BYTES - 1);
+	}
+};
+
+/***********************************************************/
+#endif
@@ -0,0 +1,31 @@
+#ifndef _PREDICTOR_BASE_H_
+#define _PREDICTOR_BASE_H_
+
+#include "utils.h"
+#include "tracer.h"
+#include <bitset>
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+//Interface shared by every predictor variant. Each variant declares its PREDICTOR
+//in its own namespace (ltageFinal, ltageOpt, ltageOpt2, ltage, ppm, tage, perceptron), so one
+//binary can link and hold any mix of them. predictor.h picks the variant the
+//simulator calls PREDICTOR, and HYBRID_PREDICTOR (hybridPredictor.h) runs two or three of
+//them as one behind a chooser.
+class PREDICTOR_BASE{
+public:
+  	virtual ~PREDICTOR_BASE() {}
+
+  	virtual bool    GetPrediction(UINT32 PC) = 0;
+  	virtual void    UpdatePredictor(UINT32 PC, bool resolveDir, bool predDir, UINT32 branchTarget) = 0;
+  	virtual void    TrackOtherInst(UINT32 PC, OpType opType, UINT32 branchTarget) = 0;
+
+	//read global history from ghr instead of a private copy, before the first branch. The
+	//caller then shifts each resolved direction into ghr before calling UpdatePredictor, and the
+	//variant no longer shifts it itself. Variants whose history has another format return false
+	//and keep their own.
+	virtual bool    shareHistory(std::bitset<1001> *ghr) { (void)ghr; return false; }
+};
+
+/***********************************************************/
+#endif
@@ -0,0 +1,53 @@
+#ifndef _STORAGE_BUDGET_H_
+#define _STORAGE_BUDGET_H_
+
+#include "utils.h"
+#include <cstdio>
+
+/////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////
+//Helpers for each variant's STORAGE BUDGET JUSTIFICATION. A variant derives the modelled
+//hardware bits of every component from its configuration with these, checks the total
+//against its budget with static_assert, and prints the modelled bits next to the bytes
+//the host really allocates with printStorage().
+
+//budget classes a variant's STORAGE_BUDGET is set to, in bits. The variants are compared in
+//the 32KB class. The ones that don't fit it say why next to their STORAGE_BUDGET.
+const UINT32 BUDGET_32KB = 32*1024*8;
+const UINT32 BUDGET_64KB = 64*1024*8;
+
+//bits needed to hold every value in 0..maxVal
+constexpr UINT32 bitsFor(UINT64 maxVal){
+	return maxVal == 0 ? 0 : 1 + bitsFor(maxVal >> 1);
+}
+
+//2^logEntries entries of entryBits each
+constexpr UINT64 tableBits(UINT32 logEntries, UINT64 entryBits){
+	return ((UINT64)1 << logEntries) * entryBits;
+}
+
+//sum of the first n values of a configuration array
+constexpr UINT64 sumBits(const UINT32 *bits, int n){
+	return n == 0 ? 0 : bits[n-1] + sumBits(bits, n-1);
+}
+
+//n tables, table i has 2^logEntries[i] entries of entryBits each
+constexpr UINT64 tablesBits(const UINT32 *logEntries, UINT64 entryBits, int n){
+	return n == 0 ? 0 : tableBits(logEntries[n-1], entryBits) + tablesBits(logEntries, entryBits, n-1);
+}
+
+//n tagged tables, table i has 2^logEntries[i] entries of tagBits[i] plus ctrBits each
+constexpr UINT64 taggedTableBits(const UINT32 *logEntries, const UINT32 *tagBits, UINT32 ctrBits, int n){
+	return n == 0 ? 0 : tableBits(logEntries[n-1], tagBits[n-1] + ctrBits) +
+	                    taggedTableBits(logEntries, tagBits, ctrBits, n-1);
+}
+
+//one line of the storage report
+inline void printStorage(const char *component, UINT64 modelledBits, UINT64 hostBytes){
+	printf("%-8s modelled %8llu bits = %7.2f KB   host %9llu bytes = %8.2f KB\n", component,
+	       (unsigned long long)modelledBits, modelledBits / 8192.0,
+	       (unsigned long long)hostBytes, hostBytes / 1024.0);
+}
+
+/***********************************************************/
+#endif